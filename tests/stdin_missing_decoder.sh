@@ -0,0 +1,38 @@
+#!/bin/sh
+# A compressed wordlist piped on stdin ("-") to a build without its decoder
+# must stop with an error instead of waiting on the decoder queue forever.
+#   tests/stdin_missing_decoder.sh            (from the repository root)
+# CXX / CXXFLAGS / LDLIBS override the compiler and link line.
+set -eu
+
+CXX=${CXX:-g++}
+LDLIBS=${LDLIBS:--lzip -lz}
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+# Built without -DZC_WITH_ZSTD / -DZC_WITH_XZ on purpose
+$CXX -O2 -std=c++17 ${CXXFLAGS:-} zip_cracker.cpp $LDLIBS -o "$work/zip_cracker"
+
+echo "secret data" > "$work/data.txt"
+(cd "$work" && zip -q -P zz9 target.zip data.txt)
+
+fail=0
+for fmt in zstd xz; do
+    case $fmt in   # frame magic is enough: nothing past it is ever decoded
+        zstd) magic='\050\265\057\375\004\000' ;;
+        xz)   magic='\3757zXZ\000\000\004' ;;
+    esac
+    out=$( (printf 'target.zip\n1\n-\n\n'; printf "$magic") |
+           (cd "$work" && HOME="$work" timeout -s KILL 20 ./zip_cracker --no-potfile --no-history 2>&1) ) &&
+        status=0 || status=$?
+    if [ "$status" -eq 137 ]; then
+        echo "FAIL: $fmt on stdin hung"; fail=1
+    elif [ "$status" -eq 0 ]; then
+        echo "FAIL: $fmt on stdin exited 0"; fail=1
+    elif ! printf '%s' "$out" | grep -q "$fmt wordlist on stdin but support not compiled in"; then
+        echo "FAIL: $fmt on stdin: missing error message"; fail=1
+    else
+        echo "ok: $fmt on stdin rejected"
+    fi
+done
+exit $fail
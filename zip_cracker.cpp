@@ -1,9 +1,15 @@
 /*
  * SPEED DEMON ZIP CRACKER V6.0
  * - Dynamic load balancing via thread-safe bounded queue (producer/consumer)
+ * - Candidates travel in 64 KiB blocks: one queue lock per block, not per password
  * - No std::vector usage anywhere
  * - Workers pull passwords on-demand = perfect dynamic balancing
- * - Compile: g++ -O2 -std=c++17 zip_cracker.cpp -lzip -o zip_cracker
+ * - Native ZipCrypto header check rejects ~255/256 wrong passwords before libzip
+ * - Native AES check: one PBKDF2 block for the 2-byte verifier, HMAC for survivors
+ * - Known-plaintext mode recovers ZipCrypto keys (Biham–Kocher) without the password
+ * - ?d / ?l / ?u masks of fixed length run on compile-time specialised generators
+ * - Distributed mode: a coordinator leases keyspace slices to worker processes over TCP
+ * - Compile: g++ -O2 -std=c++17 zip_cracker.cpp -lzip -lz -o zip_cracker
  *
  * @author   Zakaria
  * @origin   Z·A·K·A·R·I·A — built from scratch, line by line.
@@ -19,15 +25,75 @@
 #include <limits>
 #include <chrono>
 #include <iomanip>
-#include <queue>      // used internally for BFS generation and BoundedQueue
+#include <queue>      // used internally by BoundedQueue
 #include <array>      // used for thread pool instead of vector<thread>
 #include <cstring>
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <utility>    // index_sequence: mask kernel table
+#include <sstream>
+#include <stdexcept>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <random>     // benchmark: synthetic archives
+#include <sys/mman.h>   // memory-mapped wordlists
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>      // worker pinning
+#include <pthread.h>
+#include <sys/socket.h> // distributed mode
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <cerrno>
 #include <zip.h>
+#include <zlib.h>       // inflate probe + CRC32 in the staged verifier, gzip wordlists
+#ifdef ZC_WITH_ZSTD
+#include <zstd.h>       // zstd wordlists (-DZC_WITH_ZSTD ... -lzstd)
+#endif
+#ifdef ZC_WITH_XZ
+#include <lzma.h>       // xz wordlists (-DZC_WITH_XZ ... -llzma)
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>  // AVX2 / AVX-512 / SHA-NI kernels (runtime dispatched)
+#include <cpuid.h>
+#define ZC_X86 1
+#endif
 
 // ── Constants ────────────────────────────────────────────────────────────────
-constexpr int    MAX_THREADS     = 64;
-constexpr size_t QUEUE_CAPACITY  = 50'000;    // bounded queue buffer size
-constexpr size_t MAX_MASK_SIZE   = 15'000'000;
+constexpr int    MAX_THREADS     = 1024;        // = CPU_SETSIZE; the pool is sized to the machine
+constexpr size_t BLOCK_BYTES     = 64 * 1024;  // candidate arena per transport block
+constexpr size_t BLOCK_POOL      = 256;         // min blocks in flight (free + full), 4 per worker
+constexpr size_t POOL_SLAB       = 8;           // ranges a worker takes per trip to the shared counter
+constexpr size_t MAX_CANDIDATE   = 0xFFFF;      // length prefix is 16 bits
+constexpr size_t   MAX_MASK_LEN    = 256;         // mask positions
+constexpr size_t   MASK_LANE       = MAX_MASK_LEN + 1;   // lane slot: candidate + NUL
+constexpr size_t   MASK_KERNEL_LEN = 12;          // longest mask with a specialised kernel
+constexpr uint64_t MAX_KEYSPACE    = 1ull << 62;  // leaves headroom for range claims
+constexpr uint64_t MASK_CHUNK      = 1 << 16;     // max indices claimed per trip
+constexpr uint64_t WORDLIST_CHUNK  = 1 << 20;     // max wordlist bytes claimed per trip
+constexpr uint64_t COMPILED_CHUNK  = 1 << 17;     // max compiled-wordlist entries per trip
+constexpr size_t   DECOMP_CHUNK    = 1 << 20;     // decompressed bytes per pipeline chunk
+constexpr size_t   DECOMP_QUEUE    = 16;          // chunks buffered ahead of the producer
+constexpr int      CHECKPOINT_SECS = 30;          // checkpoint interval
+constexpr size_t   PROBE_BYTES     = 256;         // first-block inflate probe
+constexpr size_t   VERIFY_CHUNK    = 64 * 1024;   // staged decrypt / inflate buffer
+constexpr uint64_t MAX_PAYLOAD     = 256ull << 20;  // larger entries: libzip finishes
+constexpr size_t   RULE_MAX_LEN    = 256;         // longest rule input / output (as hashcat)
+constexpr int      MAX_RULE_OPS    = 31;          // functions per rule line
+constexpr size_t   MARKOV_POSITIONS = 32;         // trained positions (later ones reuse the last)
+constexpr size_t   JOIN_MAX_LEN    = 512;         // longest hybrid / combinator candidate
+constexpr int      STATS_TICK_MS   = 250;         // reporter sampling / TTY refresh
+constexpr uint64_t STATS_SAMPLE    = 64;          // 1 batch in N has its generate/check timed
+constexpr int      NET_MAX_NODES   = 256;         // coordinator: connected worker processes
+constexpr int      LEASE_SECS      = 10;          // lease length at a node's measured rate
+constexpr int      LEASE_TIMEOUT   = 30;          // silent seconds before a node's lease is reissued
+constexpr size_t   NET_MAX_LINE    = 1 << 20;     // longest protocol line
 
 // ── Character sets ───────────────────────────────────────────────────────────
 constexpr const char* DIGITS   = "0123456789";
@@ -39,12 +105,12 @@ const     std::string ALPHANUM = std::string(DIGITS) + LOWERS + UPPERS;
 // ── Global state ─────────────────────────────────────────────────────────────
 // [Z] kernel boot — signature: 0x5A414B41524941 ("ZAKARIA" in hex)
 static constexpr const char* _sig = "\x5A\x41\x4B\x41\x52\x49\x41"; // ZAKARIA
-std::atomic<bool>   password_found(false);
-std::atomic<size_t> attempts_made(0);
+std::atomic<bool>   password_found(false);   // every target solved: stop
 std::atomic<size_t> total_passwords(0);   // incremented by producer as it enqueues
-std::string         correct_password;
 std::mutex          password_mutex;
 std::mutex          progress_mutex;
+std::atomic<bool>   stop_requested(false);   // SIGINT / SIGTERM: save and exit
+std::atomic<bool>   wordlist_failed(false);  // streamed wordlist unreadable / cut short
 
 // ══════════════════════════════════════════════════════════════════════════════
 // Thread-safe bounded queue (replaces the passwords vector entirely)
@@ -97,6 +163,74 @@ public:
     }
 };
 
+// ══════════════════════════════════════════════════════════════════════════════
+// Block transport  —  candidates move in packed arenas, one lock per block
+// Layout per entry: [u16 length][bytes][NUL], so workers hand pointers straight
+// into the block to the verifier and libzip. Empty blocks are recycled through
+// a free-list; the pool is allocated once up front.
+// ══════════════════════════════════════════════════════════════════════════════
+struct CandidateBlock {
+    std::array<char, BLOCK_BYTES> data;
+    size_t                        used  = 0;
+    size_t                        count = 0;
+
+    void clear() { used = 0; count = 0; }
+
+    bool add(const char* pwd, size_t len) {
+        if (used + len + 3 > BLOCK_BYTES) return false;
+        uint16_t l = static_cast<uint16_t>(len);
+        std::memcpy(&data[used], &l, 2);
+        std::memcpy(&data[used + 2], pwd, len);
+        data[used + 2 + len] = '\0';
+        used += len + 3;
+        ++count;
+        return true;
+    }
+
+    // Iterate entries; `off` starts at 0
+    bool next(size_t& off, const char*& pwd, uint32_t& len) const {
+        if (off >= used) return false;
+        uint16_t l;
+        std::memcpy(&l, &data[off], 2);
+        pwd = &data[off + 2];
+        len = l;
+        off += l + 3u;
+        return true;
+    }
+};
+
+class CandidateChannel {
+    std::unique_ptr<CandidateBlock[]> blocks_;
+    BoundedQueue<CandidateBlock*>     free_;
+    BoundedQueue<CandidateBlock*>     full_;
+
+public:
+    explicit CandidateChannel(size_t nblocks)
+        : blocks_(new CandidateBlock[nblocks]), free_(nblocks), full_(nblocks) {
+        for (size_t i = 0; i < nblocks; ++i) free_.push(&blocks_[i]);
+    }
+
+    // Producer side: empty block, or nullptr once the channel is closed
+    CandidateBlock* acquire() {
+        CandidateBlock* b = nullptr;
+        if (!free_.pop(b)) return nullptr;
+        b->clear();
+        return b;
+    }
+    bool publish(CandidateBlock* b) { return full_.push(b); }
+    void producer_done()            { full_.set_done(); }
+
+    // Worker side: filled block, or nullptr once drained
+    CandidateBlock* take() {
+        CandidateBlock* b = nullptr;
+        return full_.pop(b) ? b : nullptr;
+    }
+    void release(CandidateBlock* b) { free_.push(b); }
+
+    // Password found: wake everyone on both ends
+    void close() { free_.set_done(); full_.set_done(); }
+};
+
 // ── Utility helpers ───────────────────────────────────────────────────────────
 std::string get_encryption_name(uint16_t method) {
     switch (method) {
@@ -150,285 +284,4821 @@ bool safe_multiply(size_t a, size_t b, size_t& result) {
     return true;
 }
 
-size_t estimate_mask_size(const std::string& mask) {
-    size_t total = 1;
-    for (size_t i = 0; i < mask.size(); ++i) {
-        if (mask[i] == '?' && i + 1 < mask.size()) {
-            size_t mult = 0;
-            switch (mask[i + 1]) {
-                case 'd': mult = 10;               break;
-                case 'l': mult = 26;               break;
-                case 'u': mult = 26;               break;
-                case 's': mult = strlen(SPECIALS); break;
-                case 'a': mult = ALPHANUM.size();  break;
-                default:  ++i; continue;
-            }
-            size_t nt;
-            if (!safe_multiply(total, mult, nt))
-                return std::numeric_limits<size_t>::max();
-            total = nt;
+// ══════════════════════════════════════════════════════════════════════════════
+// Compressed wordlists  —  decompression stage ahead of line splitting
+// Input is recognised by magic bytes. gzip uses zlib (always linked); zstd and
+// xz are compiled in with -DZC_WITH_ZSTD -lzstd / -DZC_WITH_XZ -llzma.
+// A decoder thread pushes decompressed chunks, in order, through a
+// BoundedQueue, so decompression overlaps parsing and verification.
+// Multi-frame zstd files (pzstd, zstd --rsyncable, concatenated .zst) are
+// split at frame boundaries and decoded in parallel; xz uses liblzma's
+// threaded decoder (multi-block files from xz -T). gzip has no frame index
+// and inflates on one thread.
+// ══════════════════════════════════════════════════════════════════════════════
+enum Compression { COMP_NONE, COMP_GZIP, COMP_ZSTD, COMP_XZ };
+
+Compression detect_compression(const unsigned char* p, size_t n) {
+    if (n >= 2 && p[0] == 0x1F && p[1] == 0x8B) return COMP_GZIP;
+    if (n >= 4 && p[1] == 0xB5 && p[2] == 0x2F && p[3] == 0xFD && p[0] == 0x28) return COMP_ZSTD;
+    if (n >= 4 && (p[0] & 0xF0) == 0x50 && p[1] == 0x2A && p[2] == 0x4D && p[3] == 0x18)
+        return COMP_ZSTD;                                   // skippable frame (pzstd)
+    if (n >= 6 && memcmp(p, "\xFD" "7zXZ\0", 6) == 0) return COMP_XZ;
+    return COMP_NONE;
+}
+
+Compression sniff_compression(const std::string& path) {
+    unsigned char head[6];
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return COMP_NONE;
+    size_t n = std::fread(head, 1, sizeof(head), f);
+    std::fclose(f);
+    return detect_compression(head, n);
+}
+
+const char* compression_name(Compression c) {
+    return c == COMP_GZIP ? "gzip" : c == COMP_ZSTD ? "zstd" : c == COMP_XZ ? "xz" : "plain";
+}
+
+// Build flags a format needs, or nullptr when it is compiled in
+const char* compression_missing(Compression c) {
+#ifndef ZC_WITH_ZSTD
+    if (c == COMP_ZSTD) return "-DZC_WITH_ZSTD ... -lzstd";
+#endif
+#ifndef ZC_WITH_XZ
+    if (c == COMP_XZ) return "-DZC_WITH_XZ ... -llzma";
+#endif
+    (void)c;
+    return nullptr;
+}
+
+class WordlistStream {
+    FILE*                     f_;
+    int                       threads_;
+    unsigned char             head_[6];
+    size_t                    head_len_ = 0;
+    Compression               comp_     = COMP_NONE;
+    BoundedQueue<std::string> out_;
+    std::thread               thread_;
+    std::atomic<bool>         abort_{false};    // consumer gone
+    std::atomic<bool>         failed_{false};   // corrupt, truncated or undecodable input
+
+    // Compressed bytes: the sniffed head first, then the file
+    size_t read_input(unsigned char* buf, size_t cap) {
+        size_t n = 0;
+        if (head_len_) {
+            n = std::min(head_len_, cap);
+            memcpy(buf, head_, n);
+            memmove(head_, head_ + n, head_len_ - n);
+            head_len_ -= n;
+        }
+        return n + std::fread(buf + n, 1, cap - n, f_);
+    }
+    // False once the consumer stopped listening
+    bool emit(std::string& chunk) { return !chunk.empty() && !abort_ ? out_.push(std::move(chunk)) : !abort_; }
+
+    void run() {
+        bool ok = true;
+        if (comp_ == COMP_GZIP) ok = run_gzip();
+#ifdef ZC_WITH_ZSTD
+        if (comp_ == COMP_ZSTD) ok = run_zstd();
+#endif
+#ifdef ZC_WITH_XZ
+        if (comp_ == COMP_XZ) ok = run_xz();
+#endif
+        if (!ok && !abort_) failed_.store(true);
+        out_.set_done();
+    }
+
+    // Concatenated members (pigz, cat a.gz b.gz) are read back to back
+    bool run_gzip() {
+        z_stream zs{};
+        if (inflateInit2(&zs, 16 + MAX_WBITS) != Z_OK) return false;
+        std::unique_ptr<unsigned char[]> in(new unsigned char[DECOMP_CHUNK]);
+        std::string out(DECOMP_CHUNK, '\0');
+        size_t      used   = 0;
+        bool        ok     = true, in_member = false;
+        while (!abort_) {
+            if (zs.avail_in == 0) {
+                zs.next_in  = in.get();
+                zs.avail_in = static_cast<uInt>(read_input(in.get(), DECOMP_CHUNK));
+                if (zs.avail_in == 0) break;
+            }
+            zs.next_out  = reinterpret_cast<Bytef*>(&out[used]);
+            zs.avail_out = static_cast<uInt>(out.size() - used);
+            int rc = inflate(&zs, Z_NO_FLUSH);
+            used = out.size() - zs.avail_out;
+            in_member = true;
+            if (rc == Z_STREAM_END) {
+                inflateReset(&zs);
+                in_member = false;
+            } else if (rc != Z_OK && rc != Z_BUF_ERROR) {
+                ok = false;
+                break;
+            }
+            if (used == out.size()) {
+                if (!emit(out)) break;
+                out.assign(DECOMP_CHUNK, '\0');
+                used = 0;
+            }
+        }
+        out.resize(used);
+        emit(out);
+        inflateEnd(&zs);
+        return ok && !in_member;
+    }
+
+#ifdef ZC_WITH_ZSTD
+    // Whole region (one or more frames) into `out`
+    static bool zstd_decode(ZSTD_DCtx* d, const unsigned char* src, size_t n, std::string& out) {
+        unsigned long long hint = ZSTD_getFrameContentSize(src, n);
+        out.clear();
+        if (hint != ZSTD_CONTENTSIZE_UNKNOWN && hint != ZSTD_CONTENTSIZE_ERROR && hint < (1ull << 32))
+            out.reserve(static_cast<size_t>(hint));
+        ZSTD_DCtx_reset(d, ZSTD_reset_session_only);
+        ZSTD_inBuffer in{src, n, 0};
+        size_t        rc = 1;
+        while (in.pos < in.size) {
+            size_t used = out.size();
+            out.resize(std::max(used + ZSTD_DStreamOutSize(), out.capacity()));
+            ZSTD_outBuffer o{&out[0], out.size(), used};
+            rc = ZSTD_decompressStream(d, &o, &in);
+            out.resize(o.pos);
+            if (ZSTD_isError(rc)) return false;
+        }
+        return rc == 0;
+    }
+
+    bool run_zstd() {
+        // Regular files: walk frame headers and decode frames in parallel
+        struct stat st;
+        if (f_ != stdin && threads_ > 1 && fstat(fileno(f_), &st) == 0 &&
+            S_ISREG(st.st_mode) && st.st_size > 0) {
+            size_t size = static_cast<size_t>(st.st_size);
+            void*  m    = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileno(f_), 0);
+            if (m != MAP_FAILED) {
+                const unsigned char* data = static_cast<const unsigned char*>(m);
+                int r = run_zstd_frames(data, size);
+                munmap(m, size);
+                if (r >= 0) return r == 1;
+            }
+        }
+        // Pipes and single-frame files: one streaming decoder
+        ZSTD_DCtx* d = ZSTD_createDCtx();
+        std::unique_ptr<unsigned char[]> buf(new unsigned char[ZSTD_DStreamInSize()]);
+        std::string out(DECOMP_CHUNK, '\0');
+        ZSTD_outBuffer o{&out[0], out.size(), 0};
+        size_t rc = 0;
+        bool   ok = true;
+        while (ok && !abort_) {
+            size_t        n = read_input(buf.get(), ZSTD_DStreamInSize());
+            ZSTD_inBuffer in{buf.get(), n, 0};
+            if (n == 0) break;
+            while (in.pos < in.size) {
+                rc = ZSTD_decompressStream(d, &o, &in);
+                if (ZSTD_isError(rc)) { ok = false; break; }
+                if (o.pos == o.size) {
+                    if (!emit(out)) { abort_ = true; break; }
+                    out.assign(DECOMP_CHUNK, '\0');
+                    o = ZSTD_outBuffer{&out[0], out.size(), 0};
+                }
+            }
+        }
+        out.resize(o.pos);
+        emit(out);
+        ZSTD_freeDCtx(d);
+        return ok && rc == 0;
+    }
+
+    // 1 = done, 0 = corrupt, -1 = fewer than two frames or a damaged frame
+    // table (stream it instead, which still yields the intact prefix)
+    int run_zstd_frames(const unsigned char* data, size_t size) {
+        size_t frames = 0;
+        for (size_t off = 0; off < size; ++frames) {
+            size_t fs = ZSTD_findFrameCompressedSize(data + off, size - off);
+            if (ZSTD_isError(fs)) return -1;
+            off += fs;
+        }
+        if (frames < 2) return -1;
+        std::unique_ptr<size_t[]> at(new size_t[frames + 1]);
+        at[0] = 0;
+        for (size_t i = 0; i < frames; ++i)
+            at[i + 1] = at[i] + ZSTD_findFrameCompressedSize(data + at[i], size - at[i]);
+
+        // Decoder w handles frames w, w+K, ...; its slot hands them over in order
+        struct Slot {
+            std::mutex              m;
+            std::condition_variable cv;
+            std::string             data;
+            bool                    full = false, ok = true;
+        };
+        const size_t             K = std::min<size_t>(static_cast<size_t>(threads_), frames);
+        std::unique_ptr<Slot[]>  slots(new Slot[K]);
+        std::atomic<bool>        quit(false);
+        auto decoder = [&](size_t w) {
+            ZSTD_DCtx* d = ZSTD_createDCtx();
+            for (size_t i = w; i < frames && !quit; i += K) {
+                std::string buf;
+                bool        ok = zstd_decode(d, data + at[i], at[i + 1] - at[i], buf);
+                Slot&       s  = slots[w];
+                std::unique_lock<std::mutex> lk(s.m);
+                s.cv.wait(lk, [&] { return !s.full || quit; });
+                if (quit) break;
+                s.data = std::move(buf);
+                s.ok   = ok;
+                s.full = true;
+                s.cv.notify_all();
+                if (!ok) break;
+            }
+            ZSTD_freeDCtx(d);
+        };
+        std::unique_ptr<std::thread[]> pool(new std::thread[K]);
+        for (size_t w = 0; w < K; ++w) pool[w] = std::thread(decoder, w);
+
+        bool ok = true;
+        for (size_t i = 0; i < frames && ok && !abort_; ++i) {
+            Slot&       s = slots[i % K];
+            std::string chunk;
+            {
+                std::unique_lock<std::mutex> lk(s.m);
+                s.cv.wait(lk, [&] { return s.full; });
+                ok     = s.ok;
+                chunk  = std::move(s.data);
+                s.full = false;
+                s.cv.notify_all();
+            }
+            if (ok && !emit(chunk)) break;
+        }
+        quit = true;
+        for (size_t w = 0; w < K; ++w) {
+            { std::lock_guard<std::mutex> lk(slots[w].m); }
+            slots[w].cv.notify_all();
+            pool[w].join();
+        }
+        return ok ? 1 : 0;
+    }
+#endif
+
+#ifdef ZC_WITH_XZ
+    bool run_xz() {
+        lzma_stream xs = LZMA_STREAM_INIT;
+#if LZMA_VERSION >= 50040002U
+        lzma_mt mt{};
+        mt.flags              = LZMA_CONCATENATED;
+        mt.threads            = static_cast<uint32_t>(threads_);
+        mt.memlimit_threading = lzma_physmem() / 4;
+        mt.memlimit_stop      = UINT64_MAX;
+        if (lzma_stream_decoder_mt(&xs, &mt) != LZMA_OK) return false;
+#else
+        if (lzma_stream_decoder(&xs, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) return false;
+#endif
+        std::unique_ptr<unsigned char[]> in(new unsigned char[DECOMP_CHUNK]);
+        std::string out(DECOMP_CHUNK, '\0');
+        lzma_action action = LZMA_RUN;
+        lzma_ret    rc     = LZMA_OK;
+        xs.next_out  = reinterpret_cast<uint8_t*>(&out[0]);
+        xs.avail_out = out.size();
+        while (!abort_) {
+            if (xs.avail_in == 0 && action == LZMA_RUN) {
+                xs.next_in  = in.get();
+                xs.avail_in = read_input(in.get(), DECOMP_CHUNK);
+                if (xs.avail_in == 0) action = LZMA_FINISH;
+            }
+            rc = lzma_code(&xs, action);
+            if (xs.avail_out == 0 || rc == LZMA_STREAM_END) {
+                out.resize(out.size() - xs.avail_out);
+                if (!emit(out)) break;
+                out.assign(DECOMP_CHUNK, '\0');
+                xs.next_out  = reinterpret_cast<uint8_t*>(&out[0]);
+                xs.avail_out = out.size();
+            }
+            if (rc != LZMA_OK) break;
+        }
+        lzma_end(&xs);
+        return abort_ || rc == LZMA_STREAM_END;
+    }
+#endif
+
+public:
+    // Takes ownership of `f` (stdin is left open). `threads` = parallel decoders.
+    WordlistStream(FILE* f, int threads) : f_(f), threads_(std::max(1, threads)), out_(DECOMP_QUEUE) {
+        head_len_ = std::fread(head_, 1, sizeof(head_), f_);
+        comp_     = detect_compression(head_, head_len_);
+        if (comp_ == COMP_NONE) return;
+        if (compression_missing(comp_)) {       // nothing would ever fill out_
+            failed_.store(true);
+            out_.set_done();
+            return;
+        }
+        thread_ = std::thread(&WordlistStream::run, this);
+    }
+    ~WordlistStream() {
+        abort_ = true;
+        out_.set_done();
+        if (thread_.joinable()) thread_.join();
+        if (f_ != stdin) std::fclose(f_);
+    }
+    WordlistStream(const WordlistStream&) = delete;
+    WordlistStream& operator=(const WordlistStream&) = delete;
+
+    Compression compression() const { return comp_; }
+    bool        failed()      const { return failed_.load(); }
+
+    // Next chunk of (decompressed) text; false at end of input.
+    // Plain input is read straight through, without the extra thread.
+    bool next(std::string& chunk) {
+        if (comp_ != COMP_NONE) return out_.pop(chunk);
+        chunk.resize(DECOMP_CHUNK);
+        size_t n = read_input(reinterpret_cast<unsigned char*>(&chunk[0]), chunk.size());
+        chunk.resize(n);
+        return n > 0;
+    }
+};
+
+// Calls fn(ptr, len) for every non-empty line with trailing CR / space
+// stripped, until fn returns false. Lines longer than MAX_CANDIDATE arrive
+// cut to MAX_CANDIDATE + 1 bytes, so callers can still tell them apart.
+template<typename F>
+void for_each_line(WordlistStream& in, F fn) {
+    std::string chunk, carry;   // carry: line split across chunks
+    auto line = [&](const char* s, size_t len) {
+        while (len && (s[len - 1] == '\r' || s[len - 1] == ' ')) --len;
+        return len == 0 || fn(s, len);
+    };
+    while (in.next(chunk)) {
+        const char* p   = chunk.data();
+        const char* end = p + chunk.size();
+        const char* nl;
+        while ((nl = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p))))) {
+            bool more;
+            if (carry.empty()) {
+                more = line(p, static_cast<size_t>(nl - p));
+            } else {
+                carry.append(p, std::min<size_t>(nl - p, MAX_CANDIDATE + 1 - std::min(carry.size(), MAX_CANDIDATE + 1)));
+                more = line(carry.data(), carry.size());
+                carry.clear();
+            }
+            if (!more) return;
+            p = nl + 1;
+        }
+        carry.append(p, std::min<size_t>(end - p, MAX_CANDIDATE + 1 - std::min(carry.size(), MAX_CANDIDATE + 1)));
+    }
+    if (!carry.empty()) line(carry.data(), carry.size());
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Mask keyspace  —  the mask as a mixed-radix number
+// Candidate i is built straight from its index (last position varies fastest,
+// the same order the old BFS generator produced). Workers claim index ranges
+// and step an odometer in place: constant memory for any keyspace size.
+// --increment stacks one such number per length, shortest first. With Markov
+// stats each position's charset is reordered by likelihood given the previous
+// character and cut to a fixed radix, so indices stay mixed-radix.
+// ══════════════════════════════════════════════════════════════════════════════
+bool mask_charset(char code, const char*& chars, uint32_t& len) {
+    switch (code) {
+        case 'd': chars = DIGITS;           len = 10;                                  return true;
+        case 'l': chars = LOWERS;           len = 26;                                  return true;
+        case 'u': chars = UPPERS;           len = 26;                                  return true;
+        case 's': chars = SPECIALS;         len = static_cast<uint32_t>(strlen(SPECIALS)); return true;
+        case 'a': chars = ALPHANUM.c_str(); len = static_cast<uint32_t>(ALPHANUM.size()); return true;
+        default:  return false;
+    }
+}
+
+// Custom charset definition ("?l?d_" etc.) expanded, duplicates dropped
+std::string expand_charset(const std::string& def) {
+    std::array<bool, 256> seen{};
+    std::string out;
+    auto add = [&](char c) {
+        if (!seen[static_cast<unsigned char>(c)]) { seen[static_cast<unsigned char>(c)] = true; out += c; }
+    };
+    for (size_t i = 0; i < def.size(); ++i) {
+        const char* chars;
+        uint32_t    len;
+        if (def[i] == '?' && i + 1 < def.size() && mask_charset(def[i + 1], chars, len)) {
+            for (uint32_t j = 0; j < len; ++j) add(chars[j]);
             ++i;
+        } else {
+            if (def[i] == '?' && i + 1 < def.size() && def[i + 1] == '?') ++i;
+            add(def[i]);
         }
     }
-    return total;
+    return out;
 }
 
-// ── Archive helpers ───────────────────────────────────────────────────────────
-bool is_password_protected(const std::string& zip_file,
-                            bool& has_files,
-                            uint16_t& enc_method) {
-    int err;
-    zip_t* arc = zip_open(zip_file.c_str(), ZIP_RDONLY, &err);
-    if (!arc) {
-        std::cerr << "\033[1;31m[!] Failed to open ZIP (error: " << err << ")\033[0m\n";
+// Per-position character counts, plain and conditioned on the previous one
+class MarkovStats {
+    std::unique_ptr<uint64_t[]> pos_;   // [position][char]
+    std::unique_ptr<uint32_t[]> ctx_;   // [position][previous char][char]
+
+public:
+    // Plain or compressed text wordlists
+    bool train(const std::string& path) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        WordlistStream in(f, 1);
+        if (compression_missing(in.compression())) return false;
+        pos_.reset(new uint64_t[MARKOV_POSITIONS * 256]());
+        ctx_.reset(new uint32_t[MARKOV_POSITIONS * 256 * 256]());
+
+        size_t words = 0;
+        for_each_line(in, [&](const char* line, size_t len) {
+            unsigned char prev = 0;
+            for (size_t i = 0; i < len && i < MARKOV_POSITIONS; ++i) {
+                unsigned char c = static_cast<unsigned char>(line[i]);
+                ++pos_[i * 256 + c];
+                uint32_t& n = ctx_[(i * 256 + prev) * 256 + c];
+                if (n != std::numeric_limits<uint32_t>::max()) ++n;
+                prev = c;
+            }
+            ++words;
+            return true;
+        });
+        return words > 0 && !in.failed();
+    }
+
+    // Positions past the trained window reuse the last one
+    uint64_t at(size_t pos, unsigned char c) const {
+        return pos_[std::min(pos, MARKOV_POSITIONS - 1) * 256 + c];
+    }
+    uint32_t after(size_t pos, unsigned char prev, unsigned char c) const {
+        return ctx_[(std::min(pos, MARKOV_POSITIONS - 1) * 256 + prev) * 256 + c];
+    }
+};
+
+struct MaskOptions {
+    std::array<std::string, 4> custom;           // ?1..?4, expanded
+    size_t             min_len   = 0;            // --increment bounds (0 = mask length)
+    size_t             max_len   = 0;
+    const MarkovStats* markov    = nullptr;
+    double             threshold = 0;            // <1: probability mass, >=1: top N, 0: all
+};
+
+// ── Specialised kernels ──────────────────────────────────────────────────────
+// Fixed-length masks over one contiguous charset (?d / ?l / ?u at every
+// position): character = LO + digit, so the odometer is the candidate itself.
+// The carry is unrolled at compile time and candidates are copied straight
+// into the worker's lane slots. Same order as MaskKeyspace::step.
+// Writes up to `max` candidates of [pos, end) to out + k * MASK_LANE and
+// leaves `cur` on candidate `pos`; returns the count.
+using MaskKernel = int (*)(char* cur, uint64_t& pos, uint64_t end, char* out, int max);
+
+template <size_t I, char LO, char HI>
+inline void kernel_carry(char* cur) {
+    if (cur[I] != HI) { ++cur[I]; return; }
+    cur[I] = LO;
+    if constexpr (I > 0) kernel_carry<I - 1, LO, HI>(cur);
+}
+
+template <size_t L, char LO, char HI>
+int mask_kernel(char* cur, uint64_t& pos, uint64_t end, char* out, int max) {
+    // Local copy (stores to `out` cannot alias it); the last position lives in
+    // a register so the prefix is only rewritten on a carry
+    char c[L];
+    std::memcpy(c, cur, L);
+    char last = c[L - 1];
+    int  n    = 0;
+    while (n < max && pos < end) {
+        std::memcpy(out, c, L - 1);
+        out[L - 1] = last;
+        out[L]     = '\0';
+        out       += MASK_LANE;
+        ++n;
+        if (++pos == end) break;
+        if (last != HI) { ++last; continue; }
+        last = LO;
+        if constexpr (L > 1) kernel_carry<L - 2, LO, HI>(c);
+    }
+    c[L - 1] = last;
+    std::memcpy(cur, c, L);
+    return n;
+}
+
+template <char LO, char HI, size_t... I>
+constexpr std::array<MaskKernel, sizeof...(I)> kernel_row(std::index_sequence<I...>) {
+    return {{&mask_kernel<I + 1, LO, HI>...}};
+}
+
+// [charset][length - 1]
+struct MaskKernelRow { const char* chars; std::array<MaskKernel, MASK_KERNEL_LEN> fn; };
+const MaskKernelRow MASK_KERNELS[] = {
+    {DIGITS, kernel_row<'0', '9'>(std::make_index_sequence<MASK_KERNEL_LEN>())},
+    {LOWERS, kernel_row<'a', 'z'>(std::make_index_sequence<MASK_KERNEL_LEN>())},
+    {UPPERS, kernel_row<'A', 'Z'>(std::make_index_sequence<MASK_KERNEL_LEN>())},
+};
+
+class MaskKeyspace {
+    // Character for digit d after `prev`: chars[prev * stride + d]
+    struct Position { const char* chars; uint32_t radix; uint32_t stride; };
+
+    std::array<Position, MAX_MASK_LEN>     pos_{};
+    std::array<std::string, MAX_MASK_LEN>  tables_;     // per-position charsets / Markov orders
+    std::array<uint64_t, MAX_MASK_LEN + 2> start_{};    // first index of each length
+    size_t                len_     = 0;
+    size_t                min_len_ = 0;
+    uint64_t              size_    = 0;
+    uint64_t              chunk_   = 1;
+    MaskKernel            kernel_  = nullptr; // specialised generator, if the shape has one
+    bool                  ok_      = true;    // false: too long, empty charset or overflow
+    std::atomic<uint64_t> next_{0};
+    uint64_t              limit_   = std::numeric_limits<uint64_t>::max();   // window end (node leases)
+
+    // Charset order for position i: most likely after `prev` first, then by
+    // position frequency, then as written
+    void markov_order(const MaskOptions& o, size_t i, const std::string& set,
+                      unsigned char prev, std::string& out) const {
+        out = set;
+        std::stable_sort(out.begin(), out.end(), [&](char a, char b) {
+            unsigned char ua = static_cast<unsigned char>(a), ub = static_cast<unsigned char>(b);
+            uint32_t ca = o.markov->after(i, prev, ua), cb = o.markov->after(i, prev, ub);
+            if (ca != cb) return ca > cb;
+            return o.markov->at(i, ua) > o.markov->at(i, ub);
+        });
+    }
+
+    // Radix kept at position i under the threshold (position frequencies)
+    uint32_t markov_radix(const MaskOptions& o, size_t i, const std::string& set) const {
+        uint32_t n = static_cast<uint32_t>(set.size());
+        if (o.threshold >= 1) return std::min<uint32_t>(n, static_cast<uint32_t>(o.threshold));
+        if (o.threshold <= 0) return n;
+
+        std::string sorted;
+        markov_order(o, i, set, 0, sorted);   // context 0 never occurs: position order
+        uint64_t total = 0;
+        for (char c : set) total += o.markov->at(i, static_cast<unsigned char>(c));
+        if (total == 0) return n;
+        uint64_t acc = 0;
+        for (uint32_t k = 0; k < n; ++k) {
+            acc += o.markov->at(i, static_cast<unsigned char>(sorted[k]));
+            if (acc >= o.threshold * total) return k + 1;
+        }
+        return n;
+    }
+
+public:
+    explicit MaskKeyspace(const std::string& mask, const MaskOptions& opts = MaskOptions()) {
+        std::array<std::string, MAX_MASK_LEN> sets;
+        for (size_t i = 0; i < mask.size() && ok_; ++i) {
+            if (len_ == MAX_MASK_LEN) { ok_ = false; break; }
+            const char* chars;
+            uint32_t    n;
+            if (mask[i] == '?' && i + 1 < mask.size() && mask[i + 1] >= '1' && mask[i + 1] <= '4') {
+                sets[len_] = opts.custom[mask[i + 1] - '1'];
+                ok_ = !sets[len_].empty();
+                ++i;
+            } else if (mask[i] == '?' && i + 1 < mask.size() && mask_charset(mask[i + 1], chars, n)) {
+                sets[len_].assign(chars, n);
+                ++i;
+            } else {
+                // Literal — includes '?' followed by an unknown code
+                sets[len_].assign(1, mask[i]);
+            }
+            ++len_;
+        }
+
+        for (size_t i = 0; i < len_; ++i) {
+            Position& p = pos_[i];
+            if (!opts.markov || sets[i].size() == 1) {
+                tables_[i] = sets[i];
+                p = {tables_[i].data(), static_cast<uint32_t>(sets[i].size()), 0};
+                continue;
+            }
+            // One ordered row per possible previous character
+            uint32_t    r = markov_radix(opts, i, sets[i]);
+            std::string row;
+            tables_[i].resize(256 * static_cast<size_t>(r));
+            for (int prev = 0; prev < 256; ++prev) {
+                markov_order(opts, i, sets[i], static_cast<unsigned char>(prev), row);
+                std::memcpy(&tables_[i][prev * r], row.data(), r);
+            }
+            p = {tables_[i].data(), r, r};
+        }
+
+        min_len_ = opts.min_len ? std::min(opts.min_len, len_) : len_;
+        size_t max_len = opts.max_len ? std::min(opts.max_len, len_) : len_;
+        if (max_len < min_len_) max_len = min_len_;
+        len_ = max_len;
+
+        // start_[L] = first index of length-L candidates
+        uint64_t span = 1;
+        for (size_t L = 1; L <= len_ && ok_; ++L) {
+            size_t nt = 0;
+            if (!safe_multiply(span, pos_[L - 1].radix, nt) || nt > MAX_KEYSPACE) ok_ = false;
+            span = nt;
+            if (L < min_len_) continue;
+            start_[L] = size_;
+            size_    += span;
+            if (size_ > MAX_KEYSPACE) ok_ = false;
+        }
+        start_[len_ + 1] = size_;
+        fit_workers(1);
+
+        // One length, no Markov rows, the same ?d / ?l / ?u set everywhere
+        if (ok_ && min_len_ == len_ && len_ >= 1 && len_ <= MASK_KERNEL_LEN) {
+            for (const MaskKernelRow& row : MASK_KERNELS) {
+                bool uniform = true;
+                for (size_t i = 0; i < len_ && uniform; ++i)
+                    uniform = pos_[i].stride == 0 && tables_[i] == row.chars;
+                if (uniform) { kernel_ = row.fn[len_ - 1]; break; }
+            }
+        }
+    }
+    MaskKeyspace(const MaskKeyspace&) = delete;
+    MaskKeyspace& operator=(const MaskKeyspace&) = delete;
+
+    bool     valid()  const { return ok_ && len_ > 0; }
+    size_t   length() const { return len_; }
+    uint64_t size()   const { return size_; }
+
+    // Rewrite cur[from..] after digits changed there (later chars depend on earlier)
+    void fill(size_t from, std::string& cur, const uint32_t* digits) const {
+        for (size_t i = from; i < cur.size(); ++i) {
+            unsigned char prev = i ? static_cast<unsigned char>(cur[i - 1]) : 0;
+            cur[i] = pos_[i].chars[prev * pos_[i].stride + digits[i]];
+        }
+    }
+
+    // Position the odometer on candidate `index`
+    void seek(uint64_t index, std::string& cur, uint32_t* digits) const {
+        size_t L = min_len_;
+        while (L < len_ && index >= start_[L + 1]) ++L;
+        index -= start_[L];
+        cur.reserve(len_);
+        cur.resize(L);
+        for (size_t i = L; i-- > 0; ) {
+            digits[i] = static_cast<uint32_t>(index % pos_[i].radix);
+            index    /= pos_[i].radix;
+        }
+        fill(0, cur, digits);
+    }
+
+    // Advance to the next candidate in place (no allocation)
+    void step(std::string& cur, uint32_t* digits) const {
+        for (size_t i = cur.size(); i-- > 0; ) {
+            if (++digits[i] < pos_[i].radix) { fill(i, cur, digits); return; }
+            digits[i] = 0;
+        }
+        // Every length-L candidate done: first candidate of length L + 1
+        if (cur.size() < len_) {
+            digits[cur.size()] = 0;
+            cur.push_back('\0');
+        }
+        fill(0, cur, digits);
+    }
+
+    bool specialised() const { return kernel_ != nullptr; }
+
+    // Up to `max` candidates of [pos, end) into lane slots out + k * MASK_LANE,
+    // leaving cur on candidate `pos`. The kernel keeps no digits, so one cursor
+    // sticks to one path; `generic` forces the odometer (benchmark).
+    int emit(uint64_t& pos, uint64_t end, std::string& cur, uint32_t* digits,
+             char* out, uint32_t* lens, int max, bool generic = false) const {
+        if (kernel_ && !generic) {
+            int n = kernel_(&cur[0], pos, end, out, max);
+            std::fill(lens, lens + n, static_cast<uint32_t>(len_));
+            return n;
+        }
+        int n = 0;
+        for (; n < max && pos < end; ++n, out += MASK_LANE) {
+            std::memcpy(out, cur.data(), cur.size());
+            out[cur.size()] = '\0';
+            lens[n] = static_cast<uint32_t>(cur.size());
+            if (++pos < end) step(cur, digits);
+        }
+        return n;
+    }
+
+    // Resume support: first index not yet handed out / skip ahead before start
+    uint64_t next_unclaimed() const { return std::min({size_, limit_, next_.load()}); }
+    void     start_at(uint64_t index) { next_.store(std::min(size_, index)); }
+    // Distributed node: only [begin, end) is handed out until the next window
+    void     window(uint64_t begin, uint64_t end) { limit_ = end; start_at(begin); }
+
+    // Chunk for a pool of `workers`: ~16 trips each, at most MASK_CHUNK
+    void fit_workers(int workers) {
+        chunk_ = std::max<uint64_t>(1, std::min<uint64_t>(MASK_CHUNK,
+                                                          size_ / (std::max(workers, 1) * 16u)));
+    }
+
+    // Hand out the next [begin, end) range of `units` chunks; false when exhausted
+    uint64_t chunk() const { return chunk_; }
+    bool claim(uint64_t& begin, uint64_t& end, uint64_t units = 1) {
+        uint64_t stop = std::min(size_, limit_);
+        uint64_t b    = next_.fetch_add(chunk_ * units);
+        if (b >= stop) return false;
+        begin = b;
+        end   = std::min(stop, b + chunk_ * units);
+        return true;
+    }
+};
+
+// Real keyspace under the options (increment, custom sets, Markov cut-off)
+size_t estimate_mask_size(const std::string& mask, const MaskOptions& opts = MaskOptions()) {
+    MaskKeyspace ks(mask, opts);
+    return ks.valid() ? ks.size() : std::numeric_limits<size_t>::max();
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Memory-mapped wordlist  —  workers claim newline-aligned byte ranges
+// A range [b, e) owns every line that *starts* inside it, so ranges can be cut
+// at fixed offsets and still cover each line exactly once. Lines come out as
+// string_views into the mapping: no producer thread, no copies.
+//
+// Compiled wordlists (compile-wordlist) are recognised by their magic and use
+// entry indices instead of bytes. Entries are deduplicated and stored without
+// separators in one bucket per length, so entry i is found in O(1):
+//   "ZCWLIST1"  u32 buckets  u32 0  u64 entries
+//   buckets × { u32 len  u32 0  u64 count  u64 offset }   (ascending len)
+//   bucket data: count × len bytes each                   (host byte order)
+// ══════════════════════════════════════════════════════════════════════════════
+constexpr char COMPILED_MAGIC[8] = {'Z', 'C', 'W', 'L', 'I', 'S', 'T', '1'};
+
+struct CompiledBucket {
+    uint32_t len      = 0;
+    uint32_t reserved = 0;
+    uint64_t count    = 0;
+    uint64_t offset   = 0;   // of the bucket data in the file
+};
+
+class MappedWordlist {
+    const char*           data_   = nullptr;
+    uint64_t              bytes_  = 0;       // mapping length
+    uint64_t              size_   = 0;       // bytes, or entries when compiled
+    uint64_t              chunk_  = 1;
+    int                   workers_ = 1;      // pool size the chunk is fitted to
+    uint64_t              factor_  = 1;      // candidates per entry (scale_chunk)
+    bool                  mapped_ = false;
+    bool                  damaged_ = false;  // compiled magic, bad table
+    std::atomic<uint64_t> next_{0};
+    uint64_t              limit_  = std::numeric_limits<uint64_t>::max();   // window end (node leases)
+
+    // Compiled format: bucket table plus the index of each bucket's first entry
+    std::unique_ptr<CompiledBucket[]> buckets_;
+    std::unique_ptr<uint64_t[]>       first_;
+    uint32_t                          nbuckets_ = 0;
+
+    void fit_chunk() {
+        const uint64_t trips = static_cast<uint64_t>(workers_) * 16;
+        chunk_ = nbuckets_
+            ? std::max<uint64_t>(256, std::min<uint64_t>(COMPILED_CHUNK, size_ / trips))
+            : std::max<uint64_t>(4096, std::min<uint64_t>(WORDLIST_CHUNK, size_ / trips));
+        if (factor_ > 1) chunk_ = std::max<uint64_t>(compiled() ? 1 : 64, chunk_ / factor_);
+    }
+
+    bool load_compiled() {
+        uint32_t n;
+        uint64_t entries;
+        if (bytes_ < 24 || memcmp(data_, COMPILED_MAGIC, 8) != 0) return false;
+        memcpy(&n, data_ + 8, 4);
+        memcpy(&entries, data_ + 16, 8);
+        if (n > MAX_CANDIDATE || 24 + uint64_t(n) * sizeof(CompiledBucket) > bytes_) return false;
+        buckets_.reset(new CompiledBucket[n + 1]);
+        first_.reset(new uint64_t[n + 1]);
+        memcpy(buckets_.get(), data_ + 24, n * sizeof(CompiledBucket));
+        // Buckets ascend by length, lie inside the mapping past the table and
+        // do not overlap — a damaged table must not yield over-long or
+        // repeated candidates
+        uint64_t total = 0, data_end = 24 + uint64_t(n) * sizeof(CompiledBucket);
+        for (uint32_t i = 0; i < n; ++i) {
+            const CompiledBucket& b = buckets_[i];
+            if (b.len == 0 || b.len > MAX_CANDIDATE || (i && b.len <= buckets_[i - 1].len)) return false;
+            if (b.offset < data_end || b.offset > bytes_ || b.count > (bytes_ - b.offset) / b.len)
+                return false;
+            data_end  = b.offset + b.count * b.len;
+            first_[i] = total;
+            total += b.count;
+        }
+        first_[n] = total;
+        if (total != entries) return false;
+        nbuckets_ = n;
+        size_     = entries;
+        return true;
+    }
+
+public:
+    struct Cursor {
+        const char* p    = nullptr;   // next line start
+        const char* stop = nullptr;   // lines starting at/after this belong to the next range
+        uint64_t    i    = 0;         // compiled: next entry, range end, bucket of i
+        uint64_t    end  = 0;
+        uint32_t    b    = 0;
+    };
+
+    // Regular files only; pipes, FIFOs and stdin leave valid() == false.
+    // A damaged compiled file is rejected rather than read as text.
+    explicit MappedWordlist(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            bytes_ = size_ = static_cast<uint64_t>(st.st_size);
+            if (size_ == 0) {
+                mapped_ = true;
+            } else {
+                void* m = mmap(nullptr, bytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (m != MAP_FAILED) {
+                    madvise(m, bytes_, MADV_SEQUENTIAL);
+                    data_   = static_cast<const char*>(m);
+                    mapped_  = bytes_ < 8 || memcmp(data_, COMPILED_MAGIC, 8) != 0 ||
+                               load_compiled();
+                    damaged_ = !mapped_;
+                }
+            }
+        }
+        ::close(fd);
+        fit_chunk();
+    }
+    ~MappedWordlist() {
+        if (data_) munmap(const_cast<char*>(data_), bytes_);
+    }
+    MappedWordlist(const MappedWordlist&) = delete;
+    MappedWordlist& operator=(const MappedWordlist&) = delete;
+
+    bool     valid()    const { return mapped_; }
+    bool     damaged()  const { return damaged_; }
+    bool     compiled() const { return nbuckets_ > 0; }
+    uint64_t size()     const { return size_; }
+    std::string_view text() const { return std::string_view(data_ ? data_ : "", bytes_); }
+    const char* unit()  const { return compiled() ? " words" : " bytes"; }
+
+    // Each line expands into `factor` candidates (rules, hybrid part): claim
+    // proportionally fewer bytes so ranges — and checkpoints — stay fine-grained
+    void scale_chunk(uint64_t factor) { factor_ = std::max<uint64_t>(1, factor); fit_chunk(); }
+    // Chunk for a pool of `workers`: ~16 trips each
+    void fit_workers(int workers)     { workers_ = std::max(workers, 1); fit_chunk(); }
+
+    // Resume support: first byte not yet handed out / skip ahead before start
+    uint64_t next_unclaimed() const { return std::min({size_, limit_, next_.load()}); }
+    void     start_at(uint64_t offset) { next_.store(std::min(size_, offset)); }
+    // Distributed node: only [begin, end) is handed out until the next window
+    void     window(uint64_t begin, uint64_t end) { limit_ = end; start_at(begin); }
+
+    uint64_t chunk() const { return chunk_; }
+    bool claim(uint64_t& begin, uint64_t& end, uint64_t units = 1) {
+        uint64_t stop = std::min(size_, limit_);
+        uint64_t b    = next_.fetch_add(chunk_ * units);
+        if (b >= stop) return false;
+        begin = b;
+        end   = std::min(stop, b + chunk_ * units);
+        return true;
+    }
+
+    // Skip the partial line owned by the previous range
+    void seek(uint64_t begin, uint64_t end, Cursor& c) const {
+        if (compiled()) {
+            c.i   = begin;
+            c.end = end;
+            c.b   = static_cast<uint32_t>(std::upper_bound(first_.get(), first_.get() + nbuckets_,
+                                                           begin) - first_.get() - 1);
+            return;
+        }
+        const char* eof = data_ + size_;
+        const char* p   = data_ + begin;
+        if (begin > 0 && data_[begin - 1] != '\n') {
+            const void* nl = memchr(p, '\n', static_cast<size_t>(eof - p));
+            p = nl ? static_cast<const char*>(nl) + 1 : eof;
+        }
+        c.p    = p;
+        c.stop = data_ + end;
+    }
+
+    // Next non-empty line with trailing CR / space stripped
+    bool next(Cursor& c, std::string_view& line) const {
+        if (compiled()) {
+            if (c.i >= c.end) return false;
+            while (c.i >= first_[c.b + 1]) ++c.b;
+            const CompiledBucket& bk = buckets_[c.b];
+            line = std::string_view(data_ + bk.offset + (c.i - first_[c.b]) * bk.len, bk.len);
+            ++c.i;
+            return true;
+        }
+        const char* eof = data_ + size_;
+        while (c.p < c.stop) {
+            const char* s  = c.p;
+            const void* nl = memchr(s, '\n', static_cast<size_t>(eof - s));
+            const char* le = nl ? static_cast<const char*>(nl) : eof;
+            c.p = nl ? le + 1 : eof;
+            while (le > s && (le[-1] == '\r' || le[-1] == ' ')) --le;
+            if (le > s) { line = std::string_view(s, static_cast<size_t>(le - s)); return true; }
+        }
         return false;
     }
-    zip_int64_t n = zip_get_num_entries(arc, 0);
-    has_files = (n > 0);
-    if (n < 1) { zip_close(arc); return false; }
 
-    zip_stat_t st; zip_stat_init(&st);
-    if (zip_stat_index(arc, 0, 0, &st) != 0) { zip_close(arc); return false; }
+    // Lines next() would return (one pass over the mapping, for totals)
+    uint64_t count_lines() const {
+        if (compiled()) return size_;
+        Cursor           c;
+        std::string_view line;
+        uint64_t         n = 0;
+        seek(0, size_, c);
+        while (next(c, line)) ++n;
+        return n;
+    }
+};
+
+// ── compile-wordlist ──────────────────────────────────────────────────────────
+// Text wordlist → compiled format. Lines are trimmed as next() does. Within each
+// length bucket words keep their first-occurrence order, so frequency-sorted
+// lists (rockyou & co.) stay frequency-sorted per length.
+struct CompileEntry {
+    const char* p;
+    uint32_t    len;
+    uint32_t    pos;   // input order of the first occurrence
+};
+
+int compile_wordlist(const std::string& in_path, const std::string& out_path) {
+    // Compressed input is inflated into memory (one word per line) first
+    Compression comp = sniff_compression(in_path);
+    if (const char* flags = compression_missing(comp)) {
+        std::cout << "\033[1;31m[!] ERROR: " << compression_name(comp)
+                  << " support not compiled in (rebuild with " << flags << ")\033[0m\n";
+        return 1;
+    }
+    std::string inflated;
+    if (comp != COMP_NONE) {
+        FILE* f = std::fopen(in_path.c_str(), "rb");
+        if (!f) {
+            std::cout << "\033[1;31m[!] ERROR: Cannot open " << in_path << "\033[0m\n";
+            return 1;
+        }
+        WordlistStream s(f, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())));
+        for_each_line(s, [&](const char* line, size_t len) {
+            inflated.append(line, len).push_back('\n');
+            return true;
+        });
+        if (s.failed()) {
+            std::cout << "\033[1;31m[!] ERROR: " << in_path << " is corrupt or truncated\033[0m\n";
+            return 1;
+        }
+    }
+    MappedWordlist in(comp == COMP_NONE ? in_path : std::string());
+    if (comp == COMP_NONE && (!in.valid() || in.compiled())) {
+        std::cout << "\033[1;31m[!] ERROR: " << in_path
+                  << " is not a readable text wordlist\033[0m\n";
+        return 1;
+    }
+    std::string_view text = comp == COMP_NONE ? in.text() : std::string_view(inflated);
+
+    // Same trimming as MappedWordlist::next()
+    auto each_line = [&](auto fn) {
+        const char* p   = text.data();
+        const char* eof = p + text.size();
+        while (p < eof) {
+            const void* nl = memchr(p, '\n', static_cast<size_t>(eof - p));
+            const char* le = nl ? static_cast<const char*>(nl) : eof;
+            const char* s  = p;
+            p = nl ? le + 1 : eof;
+            while (le > s && (le[-1] == '\r' || le[-1] == ' ')) --le;
+            if (le > s) fn(s, static_cast<size_t>(le - s));
+        }
+    };
+    uint64_t lines = 0;
+    each_line([&](const char*, size_t) { ++lines; });
+    if (lines > std::numeric_limits<uint32_t>::max()) {
+        std::cout << "\033[1;31m[!] ERROR: More than 4G lines — split the wordlist\033[0m\n";
+        return 1;
+    }
+    std::cout << "[*] Reading " << format_number(lines) << " lines from " << in_path << "\n";
+
+    std::unique_ptr<CompileEntry[]> e(new CompileEntry[lines ? lines : 1]);
+    size_t                          n = 0, too_long = 0;
+    each_line([&](const char* line, size_t len) {
+        if (len > MAX_CANDIDATE) { ++too_long; return; }
+        e[n] = {line, static_cast<uint32_t>(len), static_cast<uint32_t>(n)};
+        ++n;
+    });
+
+    // Duplicates sort next to each other with the first occurrence in front
+    std::sort(e.get(), e.get() + n, [](const CompileEntry& a, const CompileEntry& b) {
+        if (a.len != b.len) return a.len < b.len;
+        int d = memcmp(a.p, b.p, a.len);
+        return d ? d < 0 : a.pos < b.pos;
+    });
+    size_t u = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (!u || e[i].len != e[u - 1].len || memcmp(e[i].p, e[u - 1].p, e[i].len) != 0)
+            e[u++] = e[i];
+    std::sort(e.get(), e.get() + u, [](const CompileEntry& a, const CompileEntry& b) {
+        return a.len != b.len ? a.len < b.len : a.pos < b.pos;
+    });
+
+    // One bucket per length present
+    uint32_t nb = 0;
+    for (size_t i = 0; i < u; ++i) nb += (!i || e[i].len != e[i - 1].len);
+    std::unique_ptr<CompiledBucket[]> bk(new CompiledBucket[nb ? nb : 1]);
+    for (size_t i = 0, b = 0; i < u; ++i) {
+        if (!i || e[i].len != e[i - 1].len) bk[b++].len = e[i].len;
+        ++bk[b - 1].count;
+    }
+    uint64_t off = 24 + uint64_t(nb) * sizeof(CompiledBucket);
+    for (uint32_t b = 0; b < nb; ++b) {
+        bk[b].offset = off;
+        off += bk[b].count * bk[b].len;
+    }
+
+    std::ofstream out(out_path, std::ios::binary | std::ios::trunc);
+    uint32_t      zero    = 0;
+    uint64_t      entries = u;
+    out.write(COMPILED_MAGIC, 8);
+    out.write(reinterpret_cast<const char*>(&nb), 4);
+    out.write(reinterpret_cast<const char*>(&zero), 4);
+    out.write(reinterpret_cast<const char*>(&entries), 8);
+    out.write(reinterpret_cast<const char*>(bk.get()), nb * sizeof(CompiledBucket));
+    for (size_t i = 0; i < u; ++i) out.write(e[i].p, e[i].len);
+    out.flush();
+    if (!out) {
+        std::cout << "\033[1;31m[!] ERROR: Cannot write " << out_path << "\033[0m\n";
+        return 1;
+    }
+
+    std::cout << "\033[1;32m[+] " << out_path << ": " << format_number(u) << " unique words in "
+              << nb << " length buckets (" << format_number(off) << " bytes, was "
+              << format_number(text.size()) << (comp != COMP_NONE ? " once inflated" : "")
+              << ")\033[0m\n";
+    std::cout << "[*] Dropped " << format_number(n - u) << " duplicates";
+    if (too_long) std::cout << " and " << format_number(too_long) << " over-long lines";
+    std::cout << "\n";
+    return 0;
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Rule engine  —  hashcat/John-style mangling rules
+// The rule file is compiled once into fixed op lists. Workers expand each base
+// word through every rule into their own lane buffers, so one wordlist line
+// becomes rules.count() candidates without extra disk or queue traffic.
+// Positions are 0-9 then A-Z (10-35); an op whose position is out of range
+// leaves the word unchanged, as hashcat does.
+// ══════════════════════════════════════════════════════════════════════════════
+struct RuleOp {
+    char    fn = ':';
+    uint8_t a  = 0;   // position or character
+    uint8_t b  = 0;
+};
+
+struct Rule {
+    std::array<RuleOp, MAX_RULE_OPS> ops{};
+    uint8_t                          n = 0;
+};
+
+int rule_pos(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    return -1;
+}
+
+// Argument layout per function: "" none, "N" position, "X" character
+const char* rule_args(char fn) {
+    switch (fn) {
+        case ':': case 'l': case 'u': case 'c': case 'C': case 't': case 'r':
+        case 'd': case 'f': case '{': case '}': case '[': case ']': case 'q':
+        case 'E': case 'k': case 'K':
+            return "";
+        case 'T': case 'p': case 'D': case '\'': case 'z': case 'Z':
+            return "N";
+        case '$': case '^': case '@':
+            return "X";
+        case 'x': case 'O':
+            return "NN";
+        case 'i': case 'o':
+            return "NX";
+        case 's':
+            return "XX";
+        default:
+            return nullptr;
+    }
+}
+
+bool compile_rule(const std::string& line, Rule& out) {
+    out.n = 0;
+    for (size_t i = 0; i < line.size(); ) {
+        char fn = line[i++];
+        if (fn == ' ' || fn == '\t') continue;
+        const char* args = rule_args(fn);
+        if (!args || out.n == MAX_RULE_OPS) return false;
+
+        RuleOp op;
+        op.fn = fn;
+        uint8_t* dst[2] = {&op.a, &op.b};
+        for (int k = 0; args[k]; ++k) {
+            if (i >= line.size()) return false;
+            char c = line[i++];
+            int  v = (args[k] == 'N') ? rule_pos(c) : static_cast<unsigned char>(c);
+            if (v < 0) return false;
+            *dst[k] = static_cast<uint8_t>(v);
+        }
+        out.ops[out.n++] = op;
+    }
+    return out.n > 0;
+}
+
+inline char rule_lower(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 32) : c; }
+inline char rule_upper(char c) { return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 32) : c; }
+inline char rule_toggle(char c) { return (c >= 'a' && c <= 'z') ? rule_upper(c) : rule_lower(c); }
+
+// Applies `r` to word[0..len) into out (RULE_MAX_LEN bytes). Returns the new
+// length, or -1 when the word or any intermediate result would not fit.
+int apply_rule(const Rule& r, const char* word, size_t len, char* out) {
+    if (len > RULE_MAX_LEN) return -1;
+    std::memcpy(out, word, len);
+    size_t L = len;
+
+    for (uint8_t k = 0; k < r.n; ++k) {
+        const RuleOp& op = r.ops[k];
+        const size_t  a = op.a, b = op.b;
+        switch (op.fn) {
+            case ':': break;
+            case 'l': for (size_t i = 0; i < L; ++i) out[i] = rule_lower(out[i]); break;
+            case 'u': for (size_t i = 0; i < L; ++i) out[i] = rule_upper(out[i]); break;
+            case 't': for (size_t i = 0; i < L; ++i) out[i] = rule_toggle(out[i]); break;
+            case 'c':
+            case 'C':
+                for (size_t i = 0; i < L; ++i)
+                    out[i] = (op.fn == 'c') == (i == 0) ? rule_upper(out[i]) : rule_lower(out[i]);
+                break;
+            case 'E':
+                for (size_t i = 0; i < L; ++i)
+                    out[i] = (i == 0 || out[i - 1] == ' ') ? rule_upper(out[i]) : rule_lower(out[i]);
+                break;
+            case 'T': if (a < L) out[a] = rule_toggle(out[a]); break;
+            case 'r': std::reverse(out, out + L); break;
+            case 'd':
+                if (2 * L > RULE_MAX_LEN) return -1;
+                std::memcpy(out + L, out, L);
+                L *= 2;
+                break;
+            case 'p':
+                if ((a + 1) * L > RULE_MAX_LEN) return -1;
+                for (size_t i = 1; i <= a; ++i) std::memcpy(out + i * L, out, L);
+                L *= a + 1;
+                break;
+            case 'f':
+                if (2 * L > RULE_MAX_LEN) return -1;
+                std::reverse_copy(out, out + L, out + L);
+                L *= 2;
+                break;
+            case '{': if (L > 1) std::rotate(out, out + 1, out + L); break;
+            case '}': if (L > 1) std::rotate(out, out + L - 1, out + L); break;
+            case '$':
+                if (L + 1 > RULE_MAX_LEN) return -1;
+                out[L++] = static_cast<char>(a);
+                break;
+            case '^':
+                if (L + 1 > RULE_MAX_LEN) return -1;
+                std::memmove(out + 1, out, L++);
+                out[0] = static_cast<char>(a);
+                break;
+            case '[': if (L) std::memmove(out, out + 1, --L); break;
+            case ']': if (L) --L; break;
+            case 'D':
+                if (a < L) { std::memmove(out + a, out + a + 1, L - a - 1); --L; }
+                break;
+            case 'x':
+                if (a + b <= L) { std::memmove(out, out + a, b); L = b; }
+                break;
+            case 'O':
+                if (a + b <= L) { std::memmove(out + a, out + a + b, L - a - b); L -= b; }
+                break;
+            case 'i':
+                if (a > L) break;
+                if (L + 1 > RULE_MAX_LEN) return -1;
+                std::memmove(out + a + 1, out + a, L - a);
+                out[a] = static_cast<char>(b);
+                ++L;
+                break;
+            case 'o':  if (a < L) out[a] = static_cast<char>(b); break;
+            case '\'': if (a < L) L = a; break;
+            case 's':
+                for (size_t i = 0; i < L; ++i)
+                    if (out[i] == static_cast<char>(a)) out[i] = static_cast<char>(b);
+                break;
+            case '@':
+                L = static_cast<size_t>(std::remove(out, out + L, static_cast<char>(a)) - out);
+                break;
+            case 'z':
+                if (!L) break;
+                if (L + a > RULE_MAX_LEN) return -1;
+                std::memmove(out + a, out, L);
+                std::memset(out, out[a], a);
+                L += a;
+                break;
+            case 'Z':
+                if (!L) break;
+                if (L + a > RULE_MAX_LEN) return -1;
+                std::memset(out + L, out[L - 1], a);
+                L += a;
+                break;
+            case 'q':
+                if (2 * L > RULE_MAX_LEN) return -1;
+                for (size_t i = L; i-- > 0; ) out[2 * i] = out[2 * i + 1] = out[i];
+                L *= 2;
+                break;
+            case 'k': if (L > 1) std::swap(out[0], out[1]); break;
+            case 'K': if (L > 1) std::swap(out[L - 1], out[L - 2]); break;
+        }
+    }
+    return static_cast<int>(L);
+}
+
+class RuleSet {
+public:
+    // One rule per line; blank lines and '#' comments are ignored
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in.is_open()) return false;
+        std::string line;
+        size_t lines = 0;
+        while (std::getline(in, line)) ++lines;
+
+        rules_.reset(new Rule[lines ? lines : 1]);
+        count_ = skipped_ = 0;
+        in.clear();
+        in.seekg(0);
+        while (std::getline(in, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty() || line[0] == '#') continue;
+            if (compile_rule(line, rules_[count_])) ++count_;
+            else                                    ++skipped_;
+        }
+        return count_ > 0;
+    }
+
+    size_t      count()   const { return count_; }
+    size_t      skipped() const { return skipped_; }
+    const Rule& operator[](size_t i) const { return rules_[i]; }
+
+private:
+    std::unique_ptr<Rule[]> rules_;
+    size_t count_   = 0;
+    size_t skipped_ = 0;
+};
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Hybrid and combinator attacks  —  base word × second part
+// Every base word is joined with each candidate of a mask (hybrid) or of a
+// second wordlist (combinator). Workers hold the base word and step the part
+// in place — mask odometer or mapped cursor — writing the joined candidate
+// into their lane buffers, so the cross product is never materialised.
+// ══════════════════════════════════════════════════════════════════════════════
+struct CrossPart {
+    const MaskKeyspace*   mask   = nullptr;   // hybrid: the whole mask per word
+    const MappedWordlist* words  = nullptr;   // combinator: the whole second list
+    bool                  before = false;     // part goes in front of the base word
+    uint64_t              size   = 0;         // candidates per base word
+};
+
+// Writes base+part (part+base when `before`) into out (JOIN_MAX_LEN bytes).
+// Returns the length, or -1 when the joined candidate would not fit.
+int join_part(std::string_view base, std::string_view part, bool before, char* out) {
+    size_t len = base.size() + part.size();
+    if (len > JOIN_MAX_LEN) return -1;
+    std::string_view head = before ? part : base, tail = before ? base : part;
+    memcpy(out, head.data(), head.size());
+    memcpy(out + head.size(), tail.data(), tail.size());
+    return static_cast<int>(len);
+}
+
+// ── Archive helpers ───────────────────────────────────────────────────────────
+// Entry the attack runs against, plus an optional second ZipCrypto entry whose
+// header byte cross-checks survivors (entries may mix encryption methods).
+struct TargetSelection {
+    uint64_t primary       = 0;
+    uint16_t enc_method    = ZIP_EM_NONE;   // of the primary entry
+    bool     has_secondary = false;
+    uint64_t secondary     = 0;
+    uint64_t encrypted = 0, zipcrypto = 0, aes = 0;
+};
+
+// Verification cost, compared lexicographically: ZipCrypto before AES (its
+// check skips 1000 PBKDF2 rounds), non-empty before empty (an empty entry's
+// CRC confirms every header survivor), then bytes to decrypt — deflated
+// bytes count double since each one is inflated as well.
+std::array<uint64_t, 3> entry_cost(const zip_stat_t& st) {
+    uint64_t enc = st.encryption_method == ZIP_EM_TRAD_PKWARE ? 0
+                 : (st.encryption_method == ZIP_EM_AES_128 ||
+                    st.encryption_method == ZIP_EM_AES_192 ||
+                    st.encryption_method == ZIP_EM_AES_256) ? 1 : 2;
+    uint64_t bytes = (st.comp_method == ZIP_CM_STORE) ? st.comp_size : 2 * st.comp_size;
+    return {enc, st.size == 0 ? 1u : 0u, bytes};
+}
+
+bool is_password_protected(const std::string& zip_file,
+                            bool& has_files,
+                            TargetSelection& sel) {
+    int err;
+    zip_t* arc = zip_open(zip_file.c_str(), ZIP_RDONLY, &err);
+    if (!arc) {
+        std::cerr << "\033[1;31m[!] Failed to open ZIP (error: " << err << ")\033[0m\n";
+        return false;
+    }
+    zip_int64_t n = zip_get_num_entries(arc, 0);
+    has_files = (n > 0);
+
+    // Every entry is scanned: entry 0 is often a plain README or directory
+    std::array<uint64_t, 3> best{}, second{};
+    for (zip_int64_t i = 0; i < n; ++i) {
+        zip_stat_t st; zip_stat_init(&st);
+        if (zip_stat_index(arc, static_cast<zip_uint64_t>(i), 0, &st) != 0) continue;
+        if (!(st.valid & ZIP_STAT_ENCRYPTION_METHOD) ||
+            st.encryption_method == ZIP_EM_NONE)
+            continue;
+
+        ++sel.encrypted;
+        if (st.encryption_method == ZIP_EM_TRAD_PKWARE) ++sel.zipcrypto;
+        else if (st.encryption_method != ZIP_EM_UNKNOWN) ++sel.aes;
+
+        std::array<uint64_t, 3> cost = entry_cost(st);
+        uint64_t idx = static_cast<uint64_t>(i);
+        if (sel.encrypted == 1 || cost < best) {
+            if (sel.encrypted > 1 && best[0] == 0) {   // old primary becomes the cross-check
+                sel.has_secondary = true; sel.secondary = sel.primary; second = best;
+            }
+            sel.primary = idx; sel.enc_method = st.encryption_method; best = cost;
+        } else if (cost[0] == 0 && (!sel.has_secondary || cost < second)) {
+            sel.has_secondary = true; sel.secondary = idx; second = cost;
+        }
+    }
+    // The cross-check is a ZipCrypto header byte, so the primary must be one too
+    if (sel.enc_method != ZIP_EM_TRAD_PKWARE) sel.has_secondary = false;
+    zip_close(arc);
+    return sel.encrypted > 0;
+}
+
+// Full decrypt + inflate of the target entry through libzip — the authoritative check
+bool libzip_verify(zip_t* arc, uint64_t index, const std::string& pwd) {
+    zip_file_t* zf = zip_fopen_index_encrypted(arc, index, 0, pwd.c_str());
+    if (!zf) return false;
+
+    char buf[8192];
+    zip_int64_t n = 0;
+    while ((n = zip_fread(zf, buf, sizeof(buf))) > 0) {}
+    zip_fclose(zf);
+    return n == 0;   // 0 = EOF, negative = CRC/decrypt error
+}
+
+bool test_single_password(const std::string& zip_file, uint64_t index,
+                          const std::string& pwd) {
+    int err;
+    zip_t* arc = zip_open(zip_file.c_str(), ZIP_RDONLY, &err);
+    if (!arc) return false;
+
+    bool ok = libzip_verify(arc, index, pwd);
+    zip_close(arc);
+    return ok;
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Raw archive parsing  —  central directory walk without going through libzip
+// ══════════════════════════════════════════════════════════════════════════════
+struct ZipEntryInfo {
+    uint64_t index       = 0;
+    uint64_t header_off  = 0;   // local file header offset
+    uint64_t data_off    = 0;   // first byte after the local header
+    uint64_t comp_size   = 0;   // includes encryption header / trailer
+    uint64_t uncomp_size = 0;
+    uint32_t crc         = 0;
+    uint16_t flags       = 0;   // general purpose bit flag
+    uint16_t method      = 0;   // compression method as stored
+    uint16_t mod_time    = 0;   // DOS time, used as check byte when bit 3 is set
+    uint8_t  aes_strength = 0;  // AE-x extra field: 1/2/3 = AES-128/192/256
+    std::string name;
+};
+
+uint16_t rd16(const unsigned char* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t rd32(const unsigned char* p) { return rd16(p) | (static_cast<uint32_t>(rd16(p + 2)) << 16); }
+uint64_t rd64(const unsigned char* p) { return rd32(p) | (static_cast<uint64_t>(rd32(p + 4)) << 32); }
+
+bool read_at(std::ifstream& f, uint64_t off, void* dst, size_t len) {
+    f.clear();
+    f.seekg(static_cast<std::streamoff>(off));
+    f.read(static_cast<char*>(dst), static_cast<std::streamsize>(len));
+    return static_cast<size_t>(f.gcount()) == len;
+}
+
+// Walks the central directory (ZIP64 aware), resolving each entry's data offset
+// from its local header, and calls visit(info) until it returns false.
+template <class Visit>
+bool for_each_entry(const std::string& zip_file, Visit visit) {
+    std::ifstream f(zip_file, std::ios::binary);
+    if (!f.is_open()) return false;
+    f.seekg(0, std::ios::end);
+    uint64_t fsize = static_cast<uint64_t>(f.tellg());
+    if (fsize < 22) return false;
+
+    // End of central directory: 22 bytes + up to 64 KiB of comment
+    uint64_t tail_len = std::min<uint64_t>(fsize, 22 + 0xFFFF);
+    std::string tail(tail_len, '\0');
+    if (!read_at(f, fsize - tail_len, &tail[0], tail_len)) return false;
+
+    const unsigned char* t = reinterpret_cast<const unsigned char*>(tail.data());
+    size_t eocd = std::string::npos;
+    for (size_t i = tail_len - 22 + 1; i-- > 0; )
+        if (rd32(t + i) == 0x06054b50) { eocd = i; break; }
+    if (eocd == std::string::npos) return false;
+
+    uint64_t entries = rd16(t + eocd + 10);
+    uint64_t cd_size = rd32(t + eocd + 12);
+    uint64_t cd_off  = rd32(t + eocd + 16);
+
+    if (entries == 0xFFFF || cd_size == 0xFFFFFFFF || cd_off == 0xFFFFFFFF) {
+        unsigned char loc[20], rec[56];
+        uint64_t eocd_abs = fsize - tail_len + eocd;
+        if (eocd_abs < 20 || !read_at(f, eocd_abs - 20, loc, 20) ||
+            rd32(loc) != 0x07064b50)
+            return false;
+        if (!read_at(f, rd64(loc + 8), rec, 56) || rd32(rec) != 0x06064b50)
+            return false;
+        entries = rd64(rec + 32);
+        cd_size = rd64(rec + 40);
+        cd_off  = rd64(rec + 48);
+    }
+    if (cd_off + cd_size > fsize) return false;
+
+    std::string cd(cd_size, '\0');
+    if (cd_size && !read_at(f, cd_off, &cd[0], cd_size)) return false;
+
+    const unsigned char* p   = reinterpret_cast<const unsigned char*>(cd.data());
+    const unsigned char* end = p + cd_size;
+    for (uint64_t i = 0; i < entries; ++i) {
+        if (end - p < 46 || rd32(p) != 0x02014b50) return false;
+        uint16_t name_len = rd16(p + 28), extra_len = rd16(p + 30), cmt_len = rd16(p + 32);
+        if (static_cast<uint64_t>(end - p) < 46u + name_len + extra_len + cmt_len) return false;
+
+        ZipEntryInfo out;
+        out.index       = i;
+        out.name.assign(reinterpret_cast<const char*>(p + 46), name_len);
+        out.flags       = rd16(p + 8);
+        out.method      = rd16(p + 10);
+        out.mod_time    = rd16(p + 12);
+        out.crc         = rd32(p + 16);
+        out.comp_size   = rd32(p + 20);
+        out.uncomp_size = rd32(p + 24);
+        out.header_off  = rd32(p + 42);
+
+        // ZIP64 extended information: only the saturated fields are present
+        const unsigned char* x    = p + 46 + name_len;
+        const unsigned char* xend = x + extra_len;
+        while (xend - x >= 4) {
+            uint16_t id = rd16(x), len = rd16(x + 2);
+            const unsigned char* d = x + 4;
+            if (xend - d < len) break;
+            if (id == 0x0001) {
+                const unsigned char* q = d;
+                if (out.uncomp_size == 0xFFFFFFFF && d + len - q >= 8) { out.uncomp_size = rd64(q); q += 8; }
+                if (out.comp_size   == 0xFFFFFFFF && d + len - q >= 8) { out.comp_size   = rd64(q); q += 8; }
+                if (out.header_off  == 0xFFFFFFFF && d + len - q >= 8) { out.header_off  = rd64(q); }
+            } else if (id == 0x9901 && len >= 7) {   // WinZip AES (AE-1 / AE-2)
+                out.aes_strength = d[4];
+            }
+            x = d + len;
+        }
+        p += 46 + name_len + extra_len + cmt_len;
+
+        // Entries with a damaged local header are skipped, not fatal
+        unsigned char lh[30];
+        if (!read_at(f, out.header_off, lh, 30) || rd32(lh) != 0x04034b50) continue;
+        out.data_off = out.header_off + 30 + rd16(lh + 26) + rd16(lh + 28);
+        if (out.data_off + out.comp_size > fsize) continue;
+        if (!visit(out)) break;
+    }
+    return true;
+}
+
+bool read_entry_info(const std::string& zip_file, uint64_t index, ZipEntryInfo& out) {
+    bool found = false;
+    bool ok = for_each_entry(zip_file, [&](const ZipEntryInfo& e) {
+        if (e.index != index) return true;
+        out   = e;
+        found = true;
+        return false;
+    });
+    return ok && found;
+}
+
+bool find_entry(const std::string& zip_file, const std::string& name, ZipEntryInfo& out) {
+    bool found = false;
+    bool ok = for_each_entry(zip_file, [&](const ZipEntryInfo& e) {
+        if (e.name != name) return true;
+        out   = e;
+        found = true;
+        return false;
+    });
+    return ok && found;
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Native ZipCrypto (Traditional PKWARE) verifier
+// Decrypts the 12-byte encryption header with the three-key cipher and rejects
+// on the check byte; only ~1/256 of wrong passwords ever reach libzip.
+// ══════════════════════════════════════════════════════════════════════════════
+constexpr std::array<uint32_t, 256> make_crc_table() {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k)
+            c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+        t[i] = c;
+    }
+    return t;
+}
+constexpr std::array<uint32_t, 256> CRC_TABLE = make_crc_table();
+
+inline uint32_t crc32_byte(uint32_t crc, uint8_t b) {
+    return (crc >> 8) ^ CRC_TABLE[(crc ^ b) & 0xFF];
+}
+
+struct ZipCryptoKeys {
+    uint32_t k0 = 0x12345678, k1 = 0x23456789, k2 = 0x34567890;
+
+    inline void update(uint8_t c) {
+        k0 = crc32_byte(k0, c);
+        k1 = (k1 + (k0 & 0xFF)) * 134775813u + 1;
+        k2 = crc32_byte(k2, static_cast<uint8_t>(k1 >> 24));
+    }
+    inline uint8_t stream_byte() const {
+        uint32_t t = (k2 | 2) & 0xFFFF;
+        return static_cast<uint8_t>((t * (t ^ 1)) >> 8);
+    }
+};
+
+struct ZipCryptoTarget {
+    std::array<uint8_t, 12> enc_header{};
+    uint8_t                 check = 0;   // expected last plaintext header byte
+};
+
+bool load_zipcrypto_target(const std::string& zip_file, uint64_t index,
+                           ZipCryptoTarget& out) {
+    ZipEntryInfo info;
+    if (!read_entry_info(zip_file, index, info)) return false;
+    if (!(info.flags & 0x0001) || (info.flags & 0x0040)) return false;  // not ZipCrypto
+    if (info.comp_size < 12) return false;
+
+    std::ifstream f(zip_file, std::ios::binary);
+    if (!f.is_open() || !read_at(f, info.data_off, out.enc_header.data(), 12))
+        return false;
+
+    // With a data descriptor (bit 3) the CRC is not known when the header is
+    // written, so the check byte comes from the DOS modification time instead.
+    out.check = (info.flags & 0x0008) ? static_cast<uint8_t>(info.mod_time >> 8)
+                                      : static_cast<uint8_t>(info.crc >> 24);
+    return true;
+}
+
+inline bool zipcrypto_check(const ZipCryptoTarget& zc, const char* pwd, size_t len) {
+    ZipCryptoKeys keys;
+    for (size_t i = 0; i < len; ++i)
+        keys.update(static_cast<uint8_t>(pwd[i]));
+
+    uint8_t plain = 0;
+    for (int i = 0; i < 12; ++i) {
+        plain = zc.enc_header[i] ^ keys.stream_byte();
+        keys.update(plain);
+    }
+    return plain == zc.check;
+}
+
+// ── Multi-lane kernels ───────────────────────────────────────────────────────
+// Each lane runs its own key schedule; lanes shorter than the longest password
+// in the batch are masked off so bucketed (not just equal) lengths work.
+// Returns a bit mask of lanes that survived the header check.
+constexpr int ZC_MAX_LANES = 16;
+
+struct ZipCryptoKernel {
+    const char* name;
+    int         lanes;
+    uint32_t  (*check)(const ZipCryptoTarget&, const char* const*, const uint32_t*, int);
+};
+
+uint32_t zipcrypto_lanes_scalar(const ZipCryptoTarget& zc, const char* const* pwds,
+                                const uint32_t* lens, int n) {
+    uint32_t mask = 0;
+    for (int j = 0; j < n; ++j)
+        if (zipcrypto_check(zc, pwds[j], lens[j])) mask |= 1u << j;
+    return mask;
+}
+
+#ifdef ZC_X86
+__attribute__((target("avx2")))
+uint32_t zipcrypto_lanes_avx2(const ZipCryptoTarget& zc, const char* const* pwds,
+                              const uint32_t* lens, int n) {
+    const int*    tbl = reinterpret_cast<const int*>(CRC_TABLE.data());
+    const __m256i ff  = _mm256_set1_epi32(0xFF);
+    const __m256i mul = _mm256_set1_epi32(134775813);
+    const __m256i one = _mm256_set1_epi32(1);
+
+    __m256i k0 = _mm256_set1_epi32(0x12345678);
+    __m256i k1 = _mm256_set1_epi32(0x23456789);
+    __m256i k2 = _mm256_set1_epi32(0x34567890);
+
+    uint32_t maxlen = 0;
+    for (int j = 0; j < n; ++j) maxlen = std::max(maxlen, lens[j]);
+
+    alignas(32) int32_t bytes[8], active[8];
+    for (uint32_t i = 0; i < maxlen; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            bool on   = j < n && i < lens[j];
+            bytes[j]  = on ? static_cast<uint8_t>(pwds[j][i]) : 0;
+            active[j] = on ? -1 : 0;
+        }
+        __m256i c = _mm256_load_si256(reinterpret_cast<const __m256i*>(bytes));
+        __m256i m = _mm256_load_si256(reinterpret_cast<const __m256i*>(active));
+
+        __m256i n0 = _mm256_xor_si256(_mm256_srli_epi32(k0, 8),
+                         _mm256_i32gather_epi32(tbl, _mm256_and_si256(_mm256_xor_si256(k0, c), ff), 4));
+        __m256i n1 = _mm256_add_epi32(_mm256_mullo_epi32(
+                         _mm256_add_epi32(k1, _mm256_and_si256(n0, ff)), mul), one);
+        __m256i n2 = _mm256_xor_si256(_mm256_srli_epi32(k2, 8),
+                         _mm256_i32gather_epi32(tbl, _mm256_and_si256(
+                             _mm256_xor_si256(k2, _mm256_srli_epi32(n1, 24)), ff), 4));
+        k0 = _mm256_blendv_epi8(k0, n0, m);
+        k1 = _mm256_blendv_epi8(k1, n1, m);
+        k2 = _mm256_blendv_epi8(k2, n2, m);
+    }
+
+    const __m256i two  = _mm256_set1_epi32(2);
+    const __m256i low  = _mm256_set1_epi32(0xFFFF);
+    __m256i       plain = _mm256_setzero_si256();
+    for (int i = 0; i < 12; ++i) {
+        __m256i t  = _mm256_and_si256(_mm256_or_si256(k2, two), low);
+        __m256i sb = _mm256_and_si256(_mm256_srli_epi32(
+                         _mm256_mullo_epi32(t, _mm256_xor_si256(t, one)), 8), ff);
+        plain = _mm256_xor_si256(_mm256_set1_epi32(zc.enc_header[i]), sb);
+
+        k0 = _mm256_xor_si256(_mm256_srli_epi32(k0, 8),
+                 _mm256_i32gather_epi32(tbl, _mm256_and_si256(_mm256_xor_si256(k0, plain), ff), 4));
+        k1 = _mm256_add_epi32(_mm256_mullo_epi32(
+                 _mm256_add_epi32(k1, _mm256_and_si256(k0, ff)), mul), one);
+        k2 = _mm256_xor_si256(_mm256_srli_epi32(k2, 8),
+                 _mm256_i32gather_epi32(tbl, _mm256_and_si256(
+                     _mm256_xor_si256(k2, _mm256_srli_epi32(k1, 24)), ff), 4));
+    }
+
+    __m256i  eq   = _mm256_cmpeq_epi32(plain, _mm256_set1_epi32(zc.check));
+    uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(eq)));
+    return mask & ((1u << n) - 1);
+}
+
+__attribute__((target("avx512f")))
+uint32_t zipcrypto_lanes_avx512(const ZipCryptoTarget& zc, const char* const* pwds,
+                                const uint32_t* lens, int n) {
+    const int*    tbl = reinterpret_cast<const int*>(CRC_TABLE.data());
+    const __m512i ff  = _mm512_set1_epi32(0xFF);
+    const __m512i mul = _mm512_set1_epi32(134775813);
+    const __m512i one = _mm512_set1_epi32(1);
+    // mask/maskz forms avoid GCC's -Wuninitialized on _mm512_undefined_epi32()
+    const __m512i   zero = _mm512_setzero_si512();
+    const __mmask16 ALL  = 0xFFFF;
+
+    __m512i k0 = _mm512_set1_epi32(0x12345678);
+    __m512i k1 = _mm512_set1_epi32(0x23456789);
+    __m512i k2 = _mm512_set1_epi32(0x34567890);
+
+    uint32_t maxlen = 0;
+    for (int j = 0; j < n; ++j) maxlen = std::max(maxlen, lens[j]);
+
+    alignas(64) int32_t bytes[16];
+    for (uint32_t i = 0; i < maxlen; ++i) {
+        __mmask16 m = 0;
+        for (int j = 0; j < 16; ++j) {
+            bool on  = j < n && i < lens[j];
+            bytes[j] = on ? static_cast<uint8_t>(pwds[j][i]) : 0;
+            m        = static_cast<__mmask16>(m | (on ? 1u << j : 0));
+        }
+        __m512i c = _mm512_load_si512(bytes);
+
+        __m512i n0 = _mm512_xor_si512(_mm512_maskz_srli_epi32(ALL, k0, 8),
+                         _mm512_mask_i32gather_epi32(zero, ALL, _mm512_and_si512(_mm512_xor_si512(k0, c), ff), tbl, 4));
+        __m512i n1 = _mm512_add_epi32(_mm512_mullo_epi32(
+                         _mm512_add_epi32(k1, _mm512_and_si512(n0, ff)), mul), one);
+        __m512i n2 = _mm512_xor_si512(_mm512_maskz_srli_epi32(ALL, k2, 8),
+                         _mm512_mask_i32gather_epi32(zero, ALL, _mm512_and_si512(
+                             _mm512_xor_si512(k2, _mm512_maskz_srli_epi32(ALL, n1, 24)), ff), tbl, 4));
+        k0 = _mm512_mask_mov_epi32(k0, m, n0);
+        k1 = _mm512_mask_mov_epi32(k1, m, n1);
+        k2 = _mm512_mask_mov_epi32(k2, m, n2);
+    }
+
+    const __m512i two   = _mm512_set1_epi32(2);
+    const __m512i low   = _mm512_set1_epi32(0xFFFF);
+    __m512i       plain = _mm512_setzero_si512();
+    for (int i = 0; i < 12; ++i) {
+        __m512i t  = _mm512_and_si512(_mm512_or_si512(k2, two), low);
+        __m512i sb = _mm512_and_si512(_mm512_maskz_srli_epi32(ALL, 
+                         _mm512_mullo_epi32(t, _mm512_xor_si512(t, one)), 8), ff);
+        plain = _mm512_xor_si512(_mm512_set1_epi32(zc.enc_header[i]), sb);
+
+        k0 = _mm512_xor_si512(_mm512_maskz_srli_epi32(ALL, k0, 8),
+                 _mm512_mask_i32gather_epi32(zero, ALL, _mm512_and_si512(_mm512_xor_si512(k0, plain), ff), tbl, 4));
+        k1 = _mm512_add_epi32(_mm512_mullo_epi32(
+                 _mm512_add_epi32(k1, _mm512_and_si512(k0, ff)), mul), one);
+        k2 = _mm512_xor_si512(_mm512_maskz_srli_epi32(ALL, k2, 8),
+                 _mm512_mask_i32gather_epi32(zero, ALL, _mm512_and_si512(
+                     _mm512_xor_si512(k2, _mm512_maskz_srli_epi32(ALL, k1, 24)), ff), tbl, 4));
+    }
+
+    uint32_t mask = _mm512_cmpeq_epi32_mask(plain, _mm512_set1_epi32(zc.check));
+    return mask & ((1u << n) - 1);
+}
+#endif
+
+// Picks the widest kernel the running CPU supports
+ZipCryptoKernel select_zipcrypto_kernel() {
+#ifdef ZC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return {"AVX-512", 16, zipcrypto_lanes_avx512};
+    if (__builtin_cpu_supports("avx2"))    return {"AVX2",     8, zipcrypto_lanes_avx2};
+#endif
+    return {"scalar", 1, zipcrypto_lanes_scalar};
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Native WinZip AES verifier  —  PBKDF2-HMAC-SHA1 with the 2-byte PVV short-cut
+// PBKDF2 output blocks are independent, so the check derives only the one
+// 20-byte block holding the password verification value; the full key and the
+// HMAC over the ciphertext are computed for the ~1/65536 survivors only.
+// ══════════════════════════════════════════════════════════════════════════════
+#define ZC_INLINE inline __attribute__((always_inline))
+#define ROL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+// GCC vector types: one SHA-1 stream per 32-bit lane
+typedef uint32_t u32x8  __attribute__((vector_size(32)));
+typedef uint32_t u32x16 __attribute__((vector_size(64)));
+
+inline   void     lane_set(uint32_t& v, int, uint32_t x) { v = x; }
+inline   uint32_t lane_get(uint32_t v, int)              { return v; }
+template<class V> void     lane_set(V& v, int j, uint32_t x) { v[j] = x; }
+template<class V> uint32_t lane_get(const V& v, int j)      { return v[j]; }
+
+constexpr uint32_t SHA1_IV[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+// One 64-byte block per lane; V is uint32_t or one of the vector types above.
+// always_inline so the body is compiled with the caller's target ISA.
+template<class V>
+ZC_INLINE void sha1_compress(V st[5], const V blk[16]) {
+    V w[16];
+    for (int i = 0; i < 16; ++i) w[i] = blk[i];
+    V a = st[0], b = st[1], c = st[2], d = st[3], e = st[4];
+
+#define SHA1_STEP(i, f, k)                                                       \
+    {                                                                            \
+        if ((i) >= 16) {                                                         \
+            V x = w[((i) + 13) & 15] ^ w[((i) + 8) & 15] ^                       \
+                  w[((i) + 2) & 15] ^ w[(i) & 15];                               \
+            w[(i) & 15] = ROL32(x, 1);                                           \
+        }                                                                        \
+        V t = ROL32(a, 5) + (f) + e + (k) + w[(i) & 15];                         \
+        e = d; d = c; c = ROL32(b, 30); b = a; a = t;                            \
+    }
+    for (int i =  0; i < 20; ++i) SHA1_STEP(i, (b & c) | (~b & d),          0x5A827999u)
+    for (int i = 20; i < 40; ++i) SHA1_STEP(i, b ^ c ^ d,                   0x6ED9EBA1u)
+    for (int i = 40; i < 60; ++i) SHA1_STEP(i, (b & c) | (b & d) | (c & d), 0x8F1BBCDCu)
+    for (int i = 60; i < 80; ++i) SHA1_STEP(i, b ^ c ^ d,                   0xCA62C1D6u)
+#undef SHA1_STEP
+
+    st[0] += a; st[1] += b; st[2] += c; st[3] += d; st[4] += e;
+}
+
+struct Sha1Generic {
+    template<class V>
+    ZC_INLINE void operator()(V st[5], const V blk[16]) const { sha1_compress(st, blk); }
+};
+
+#ifdef ZC_X86
+// Intel SHA extensions, one stream; blk holds host-order message words
+__attribute__((target("sha,sse4.1")))
+void sha1_compress_shani(uint32_t st[5], const uint32_t blk[16]) {
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(st)), 0x1B);
+    __m128i e0   = _mm_set_epi32(static_cast<int>(st[4]), 0, 0, 0);
+    const __m128i abcd_save = abcd, e_save = e0;
+
+    __m128i m[4];
+    for (int i = 0; i < 4; ++i)
+        m[i] = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(blk + 4 * i)), 0x1B);
+
+    __m128i e1;
+#define SHA1_RNDS(dst, src, g)                                                   \
+    switch ((g) / 5) {                                                           \
+        case 0:  abcd = _mm_sha1rnds4_epu32(abcd, src, 0); break;                \
+        case 1:  abcd = _mm_sha1rnds4_epu32(abcd, src, 1); break;                \
+        case 2:  abcd = _mm_sha1rnds4_epu32(abcd, src, 2); break;                \
+        default: abcd = _mm_sha1rnds4_epu32(abcd, src, 3); break;                \
+    }
+    e0 = _mm_add_epi32(e0, m[0]);
+    e1 = abcd;
+    SHA1_RNDS(abcd, e0, 0)
+    for (int g = 1; g < 20; ++g) {
+        __m128i w;
+        if (g < 4) {
+            w = m[g];
+        } else {
+            w = _mm_sha1msg2_epu32(_mm_xor_si128(_mm_sha1msg1_epu32(m[g & 3], m[(g + 1) & 3]),
+                                                 m[(g + 2) & 3]), m[(g + 3) & 3]);
+            m[g & 3] = w;
+        }
+        if (g & 1) { e1 = _mm_sha1nexte_epu32(e1, w); e0 = abcd; SHA1_RNDS(abcd, e1, g) }
+        else       { e0 = _mm_sha1nexte_epu32(e0, w); e1 = abcd; SHA1_RNDS(abcd, e0, g) }
+    }
+#undef SHA1_RNDS
+    e0   = _mm_sha1nexte_epu32(e0, e_save);
+    abcd = _mm_add_epi32(abcd, abcd_save);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(st), _mm_shuffle_epi32(abcd, 0x1B));
+    st[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+struct Sha1Ni {
+    __attribute__((target("sha,sse4.1")))
+    void operator()(uint32_t st[5], const uint32_t blk[16]) const { sha1_compress_shani(st, blk); }
+};
+#endif
+
+// Streaming SHA-1 for the cold paths (long HMAC keys, ciphertext MAC)
+struct Sha1 {
+    uint32_t      h[5];
+    uint64_t      total = 0;
+    unsigned char buf[64];
+    size_t        fill  = 0;
+
+    Sha1() { std::memcpy(h, SHA1_IV, sizeof(h)); }
+
+    void block(const unsigned char* p) {
+        uint32_t w[16];
+        for (int i = 0; i < 16; ++i)
+            w[i] = (uint32_t(p[4*i]) << 24) | (uint32_t(p[4*i+1]) << 16) |
+                   (uint32_t(p[4*i+2]) << 8) | p[4*i+3];
+        sha1_compress(h, w);
+    }
+    void update(const void* data, size_t len) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        total += len;
+        if (fill) {
+            size_t take = std::min(len, 64 - fill);
+            std::memcpy(buf + fill, p, take);
+            fill += take; p += take; len -= take;
+            if (fill < 64) return;
+            block(buf); fill = 0;
+        }
+        for (; len >= 64; p += 64, len -= 64) block(p);
+        std::memcpy(buf, p, len);
+        fill = len;
+    }
+    void final(unsigned char out[20]) {
+        uint64_t bits = total * 8;
+        unsigned char pad = 0x80, zero = 0;
+        update(&pad, 1);
+        while (fill != 56) update(&zero, 1);
+        unsigned char len_be[8];
+        for (int i = 0; i < 8; ++i) len_be[i] = static_cast<unsigned char>(bits >> (56 - 8 * i));
+        update(len_be, 8);
+        for (int i = 0; i < 20; ++i) out[i] = static_cast<unsigned char>(h[i / 4] >> (24 - 8 * (i % 4)));
+    }
+};
+
+// HMAC-SHA1 key schedule: chaining state after the ipad / opad block
+void hmac_sha1_pads(const char* key, size_t len, uint32_t ipad[5], uint32_t opad[5]) {
+    unsigned char k[64] = {0};
+    if (len > 64) {
+        Sha1 s; s.update(key, len); s.final(k);
+    } else {
+        std::memcpy(k, key, len);
+    }
+    uint32_t wi[16], wo[16];
+    for (int i = 0; i < 16; ++i) {
+        uint32_t x = (uint32_t(k[4*i]) << 24) | (uint32_t(k[4*i+1]) << 16) |
+                     (uint32_t(k[4*i+2]) << 8) | k[4*i+3];
+        wi[i] = x ^ 0x36363636u;
+        wo[i] = x ^ 0x5C5C5C5Cu;
+    }
+    std::memcpy(ipad, SHA1_IV, 20); sha1_compress(ipad, wi);
+    std::memcpy(opad, SHA1_IV, 20); sha1_compress(opad, wo);
+}
+
+constexpr int AES_PBKDF2_ITERATIONS = 1000;
+
+// PBKDF2 output block T_i for every lane. `first` is the (shared) message block
+// salt || INT(i) || padding; every later iteration hashes a 20-byte digest.
+template<class V, class Compress>
+ZC_INLINE void pbkdf2_sha1_block(const V ipad[5], const V opad[5], const uint32_t first[16],
+                                 V out[5], Compress compress) {
+    V msg[16], s[5], u[5];
+    for (int i = 0; i < 16; ++i) msg[i] = V{} + first[i];
+    for (int i = 0; i < 5; ++i)  s[i] = ipad[i];
+    compress(s, msg);
+
+    for (int i = 5; i < 15; ++i) msg[i] = V{};
+    msg[5]  = V{} + 0x80000000u;
+    msg[15] = V{} + static_cast<uint32_t>((64 + 20) * 8);
+    for (int i = 0; i < 5; ++i) { msg[i] = s[i]; u[i] = opad[i]; }
+    compress(u, msg);
+    for (int i = 0; i < 5; ++i) out[i] = u[i];
+
+    for (int it = 1; it < AES_PBKDF2_ITERATIONS; ++it) {
+        for (int i = 0; i < 5; ++i) { msg[i] = u[i]; s[i] = ipad[i]; }
+        compress(s, msg);
+        for (int i = 0; i < 5; ++i) { msg[i] = s[i]; u[i] = opad[i]; }
+        compress(u, msg);
+        for (int i = 0; i < 5; ++i) out[i] ^= u[i];
+    }
+}
+
+struct AesTarget {
+    int           key_len  = 0;      // 16 / 24 / 32
+    int           salt_len = 0;      // 8 / 12 / 16
+    unsigned char salt[16] = {0};
+    unsigned char pvv[2]   = {0};
+    unsigned char auth[10] = {0};    // truncated HMAC-SHA1 of the ciphertext
+    std::string   zip_file;
+    uint64_t      cipher_off = 0;
+    uint64_t      cipher_len = 0;
+};
+
+// First message block of PBKDF2 block `index` (1-based): salt || INT(index)
+void aes_salt_block(const AesTarget& t, uint32_t index, uint32_t blk[16]) {
+    unsigned char b[64] = {0};
+    std::memcpy(b, t.salt, t.salt_len);
+    for (int i = 0; i < 4; ++i) b[t.salt_len + i] = static_cast<unsigned char>(index >> (24 - 8 * i));
+    b[t.salt_len + 4] = 0x80;
+    uint64_t bits = (64 + t.salt_len + 4) * 8;
+    b[62] = static_cast<unsigned char>(bits >> 8);
+    b[63] = static_cast<unsigned char>(bits);
+    for (int i = 0; i < 16; ++i)
+        blk[i] = (uint32_t(b[4*i]) << 24) | (uint32_t(b[4*i+1]) << 16) |
+                 (uint32_t(b[4*i+2]) << 8) | b[4*i+3];
+}
+
+uint8_t digest_byte(const uint32_t d[5], int i) {
+    return static_cast<uint8_t>(d[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+bool load_aes_target(const std::string& zip_file, uint64_t index, AesTarget& out) {
+    ZipEntryInfo info;
+    if (!read_entry_info(zip_file, index, info) || info.aes_strength == 0) return false;
+
+    out.key_len  = 8 + 8 * info.aes_strength;   // 1,2,3 → 16,24,32
+    out.salt_len = out.key_len / 2;
+    if (info.comp_size < static_cast<uint64_t>(out.salt_len) + 2 + 10) return false;
+
+    std::ifstream f(zip_file, std::ios::binary);
+    if (!f.is_open() ||
+        !read_at(f, info.data_off, out.salt, out.salt_len) ||
+        !read_at(f, info.data_off + out.salt_len, out.pvv, 2) ||
+        !read_at(f, info.data_off + info.comp_size - 10, out.auth, 10))
+        return false;
+
+    out.zip_file   = zip_file;
+    out.cipher_off = info.data_off + out.salt_len + 2;
+    out.cipher_len = info.comp_size - out.salt_len - 2 - 10;
+    return true;
+}
+
+// Derived key layout: enc key | auth key | PVV (2 bytes)
+template<class V, int L, class Compress>
+ZC_INLINE uint32_t aes_pvv_lanes(const AesTarget& t, const char* const* pwds,
+                                 const uint32_t* lens, int n, Compress compress) {
+    const int pvv_pos = 2 * t.key_len;
+    const int pvv_off = pvv_pos % 20;   // both PVV bytes land in one block
+    uint32_t  first[16];
+    aes_salt_block(t, static_cast<uint32_t>(pvv_pos / 20 + 1), first);
+
+    V ipad[5] = {}, opad[5] = {}, out[5];
+    for (int j = 0; j < n; ++j) {
+        uint32_t is[5], os[5];
+        hmac_sha1_pads(pwds[j], lens[j], is, os);
+        for (int i = 0; i < 5; ++i) { lane_set(ipad[i], j, is[i]); lane_set(opad[i], j, os[i]); }
+    }
+    pbkdf2_sha1_block(ipad, opad, first, out, compress);
+
+    uint32_t mask = 0;
+    for (int j = 0; j < n && j < L; ++j) {
+        uint32_t d[5];
+        for (int i = 0; i < 5; ++i) d[i] = lane_get(out[i], j);
+        if (digest_byte(d, pvv_off) == t.pvv[0] && digest_byte(d, pvv_off + 1) == t.pvv[1])
+            mask |= 1u << j;
+    }
+    return mask;
+}
+
+struct AesKernel {
+    const char* name;
+    int         lanes;
+    uint32_t  (*check)(const AesTarget&, const char* const*, const uint32_t*, int);
+};
+
+uint32_t aes_lanes_scalar(const AesTarget& t, const char* const* pwds, const uint32_t* lens, int n) {
+    uint32_t mask = 0;
+    for (int j = 0; j < n; ++j)
+        mask |= aes_pvv_lanes<uint32_t, 1>(t, pwds + j, lens + j, 1, Sha1Generic()) << j;
+    return mask;
+}
+
+#ifdef ZC_X86
+__attribute__((target("sha,sse4.1")))
+uint32_t aes_lanes_shani(const AesTarget& t, const char* const* pwds, const uint32_t* lens, int n) {
+    uint32_t mask = 0;
+    for (int j = 0; j < n; ++j)
+        mask |= aes_pvv_lanes<uint32_t, 1>(t, pwds + j, lens + j, 1, Sha1Ni()) << j;
+    return mask;
+}
+
+__attribute__((target("avx2")))
+uint32_t aes_lanes_avx2(const AesTarget& t, const char* const* pwds, const uint32_t* lens, int n) {
+    return aes_pvv_lanes<u32x8, 8>(t, pwds, lens, n, Sha1Generic());
+}
+
+__attribute__((target("avx512f")))
+uint32_t aes_lanes_avx512(const AesTarget& t, const char* const* pwds, const uint32_t* lens, int n) {
+    return aes_pvv_lanes<u32x16, 16>(t, pwds, lens, n, Sha1Generic());
+}
+#endif
+
+AesKernel select_aes_kernel() {
+#ifdef ZC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return {"AVX-512 multi-buffer", 16, aes_lanes_avx512};
+    if (__builtin_cpu_supports("avx2"))    return {"AVX2 multi-buffer",     8, aes_lanes_avx2};
+    // no __builtin_cpu_supports("sha"); ask CPUID leaf 7 directly
+    unsigned int a, b, c, d;
+    if (__get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & (1u << 29)))
+        return {"SHA-NI", 1, aes_lanes_shani};
+#endif
+    return {"scalar", 1, aes_lanes_scalar};
+}
+
+// Full derived key (enc key | auth key | PVV) for one password
+void aes_derive(const AesTarget& t, const char* pwd, size_t len, unsigned char dk[80]) {
+    uint32_t ipad[5], opad[5];
+    hmac_sha1_pads(pwd, len, ipad, opad);
+    int blocks = (2 * t.key_len + 2 + 19) / 20;
+    for (int b = 0; b < blocks; ++b) {
+        uint32_t first[16], out[5];
+        aes_salt_block(t, static_cast<uint32_t>(b + 1), first);
+        pbkdf2_sha1_block(ipad, opad, first, out, Sha1Generic());
+        for (int i = 0; i < 20; ++i) dk[20 * b + i] = digest_byte(out, i);
+    }
+}
+
+// Survivors of the PVV check: derive the authentication key and compare the
+// stored 10-byte HMAC-SHA1 over the ciphertext. `payload` is the entry's data
+// when it fits in memory, empty otherwise (the file is streamed instead).
+bool aes_confirm(const AesTarget& t, const char* pwd, size_t len,
+                 const std::string& payload) {
+    unsigned char dk[80];
+    aes_derive(t, pwd, len, dk);
+
+    uint32_t ipad[5], opad[5];
+    hmac_sha1_pads(reinterpret_cast<const char*>(dk + t.key_len), t.key_len, ipad, opad);
+    Sha1 inner;
+    std::memcpy(inner.h, ipad, 20);
+    inner.total = 64;
+    if (!payload.empty()) {
+        inner.update(payload.data() + t.salt_len + 2, t.cipher_len);
+    } else {
+        std::ifstream f(t.zip_file, std::ios::binary);
+        if (!f.is_open()) return false;
+        f.seekg(static_cast<std::streamoff>(t.cipher_off));
+
+        char     buf[8192];
+        uint64_t left = t.cipher_len;
+        while (left > 0) {
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(left, sizeof(buf)));
+            f.read(buf, static_cast<std::streamsize>(chunk));
+            if (static_cast<size_t>(f.gcount()) != chunk) return false;
+            inner.update(buf, chunk);
+            left -= chunk;
+        }
+    }
+    unsigned char mac[20];
+    inner.final(mac);
+    Sha1 outer;
+    std::memcpy(outer.h, opad, 20);
+    outer.total = 64;
+    outer.update(mac, 20);
+    outer.final(mac);
+    return std::memcmp(mac, t.auth, 10) == 0;
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Staged verification  —  the entry's encrypted data lives in memory
+//   check : ZipCrypto header byte / AES PVV       (batched, SIMD)
+//   cross : ZipCrypto header byte of a second encrypted entry
+//   probe : ZipCrypto first block through inflate / AES HMAC over ciphertext
+//   full  : ZipCrypto full decrypt + inflate with running CRC32
+// Each stage aborts on the first sign of failure; libzip is only needed when
+// the entry is too large to keep in memory or uses another compression method.
+// ══════════════════════════════════════════════════════════════════════════════
+enum Stage { STAGE_CHECK = 0, STAGE_CROSS, STAGE_PROBE, STAGE_FULL, STAGE_COUNT };
+
+// Per-worker buffers and a reusable raw-inflate stream
+struct VerifyScratch {
+    z_stream                         zs{};
+    bool                             zs_ready = false;
+    std::unique_ptr<unsigned char[]> plain{new unsigned char[VERIFY_CHUNK]};
+    std::unique_ptr<unsigned char[]> out{new unsigned char[VERIFY_CHUNK]};
+
+    VerifyScratch() = default;
+    VerifyScratch(const VerifyScratch&) = delete;
+    VerifyScratch& operator=(const VerifyScratch&) = delete;
+    ~VerifyScratch() { if (zs_ready) inflateEnd(&zs); }
+
+    bool reset_inflate() {
+        if (zs_ready) return inflateReset(&zs) == Z_OK;
+        zs_ready = (inflateInit2(&zs, -MAX_WBITS) == Z_OK);
+        return zs_ready;
+    }
+};
+
+// Probe + full stages for a ZipCrypto header survivor. Returns the stage that
+// rejected the password, or STAGE_COUNT when every native stage passed.
+int zipcrypto_verify(const ZipEntryInfo& e, const std::string& payload,
+                     const char* pwd, size_t len, VerifyScratch& vs) {
+    const bool deflate = (e.method == 8);
+    if (!deflate && e.method != 0) return STAGE_COUNT;   // libzip decides
+    if (deflate && !vs.reset_inflate()) return STAGE_COUNT;
+
+    ZipCryptoKeys keys;
+    for (size_t i = 0; i < len; ++i) keys.update(static_cast<uint8_t>(pwd[i]));
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(payload.data());
+    for (int i = 0; i < 12; ++i) keys.update(src[i] ^ keys.stream_byte());
+    src += 12;
+
+    const uint64_t total = e.comp_size - 12;
+    const uint64_t avail = payload.size() - 12;   // probe prefix only for huge entries
+    uint64_t done = 0, produced = 0;
+    uint32_t crc  = 0;
+    bool     end  = false;
+
+    while (done < total && !end) {
+        if (done >= avail) return STAGE_COUNT;     // rest is not in memory
+        int    stage = (done == 0) ? STAGE_PROBE : STAGE_FULL;
+        size_t chunk = static_cast<size_t>(std::min<uint64_t>(
+                           avail - done, done == 0 ? PROBE_BYTES : VERIFY_CHUNK));
+        for (size_t i = 0; i < chunk; ++i) {
+            uint8_t c = src[done + i] ^ keys.stream_byte();
+            keys.update(c);
+            vs.plain[i] = c;
+        }
+        done += chunk;
+
+        if (!deflate) {
+            crc = crc32(crc, vs.plain.get(), static_cast<uInt>(chunk));
+            produced += chunk;
+            continue;
+        }
+        vs.zs.next_in  = vs.plain.get();
+        vs.zs.avail_in = static_cast<uInt>(chunk);
+        do {
+            vs.zs.next_out  = vs.out.get();
+            vs.zs.avail_out = static_cast<uInt>(VERIFY_CHUNK);
+            int    r   = inflate(&vs.zs, Z_NO_FLUSH);
+            size_t got = VERIFY_CHUNK - vs.zs.avail_out;
+            crc       = crc32(crc, vs.out.get(), static_cast<uInt>(got));
+            produced += got;
+            if (r == Z_STREAM_END) { end = true; break; }
+            if ((r != Z_OK && r != Z_BUF_ERROR) || produced > e.uncomp_size) return stage;
+        } while (vs.zs.avail_out == 0);
+    }
+    if (deflate && !end) return STAGE_FULL;
+    return (crc == e.crc && produced == e.uncomp_size) ? STAGE_COUNT : STAGE_FULL;
+}
+
+// ── Native verifier front-end (picked from the archive's encryption method) ──
+struct NativeVerifier {
+    uint16_t        method = ZIP_EM_NONE;
+    ZipCryptoTarget zc;
+    ZipCryptoKernel zc_kernel{};
+    AesTarget       aes;
+    AesKernel       aes_kernel{};
+    ZipEntryInfo    entry;
+    std::string     payload;              // encrypted entry data (prefix if huge)
+    ZipCryptoTarget cross;                // second entry, same password assumed
+    bool            has_cross    = false;
+    bool            libzip_final = true;  // native stages cannot decide alone
+
+    int lanes() const {
+        return method == ZIP_EM_TRAD_PKWARE ? zc_kernel.lanes : aes_kernel.lanes;
+    }
+    std::string engine() const {
+        return method == ZIP_EM_TRAD_PKWARE ? std::string("ZipCrypto/") + zc_kernel.name
+                                            : std::string("AES PBKDF2/") + aes_kernel.name;
+    }
+    // Cheap per-candidate filter; returns the lane mask of survivors
+    uint32_t check(const char* const* pwds, const uint32_t* lens, int n) const {
+        return method == ZIP_EM_TRAD_PKWARE ? zc_kernel.check(zc, pwds, lens, n)
+                                            : aes_kernel.check(aes, pwds, lens, n);
+    }
+    // Later stages for check survivors; rejecting stage or STAGE_COUNT
+    int verify(const char* pwd, size_t len, VerifyScratch& vs) const {
+        if (method == ZIP_EM_TRAD_PKWARE) {
+            if (has_cross && !zipcrypto_check(cross, pwd, len)) return STAGE_CROSS;
+            return zipcrypto_verify(entry, payload, pwd, len, vs);
+        }
+        const std::string none;
+        return aes_confirm(aes, pwd, len, entry.comp_size == payload.size() ? payload : none)
+                   ? STAGE_COUNT : STAGE_PROBE;
+    }
+    const char* stage_name(int stage) const {
+        static const char* const zc_names[]  = {"header check", "cross-check", "inflate probe", "CRC32"};
+        static const char* const aes_names[] = {"PVV check", "-", "HMAC", "-"};
+        if (stage == STAGE_CROSS && !has_cross) return "-";
+        return method == ZIP_EM_TRAD_PKWARE ? zc_names[stage] : aes_names[stage];
+    }
+};
+
+bool load_native_verifier(const std::string& zip_file, const TargetSelection& sel,
+                          bool cross_check, NativeVerifier& out) {
+    const uint16_t enc_method = sel.enc_method;
+    out.method = enc_method;
+    bool ok = false;
+    switch (enc_method) {
+        case ZIP_EM_TRAD_PKWARE:
+            out.zc_kernel = select_zipcrypto_kernel();
+            ok = load_zipcrypto_target(zip_file, sel.primary, out.zc);
+            break;
+        case ZIP_EM_AES_128:
+        case ZIP_EM_AES_192:
+        case ZIP_EM_AES_256:
+            out.aes_kernel = select_aes_kernel();
+            ok = load_aes_target(zip_file, sel.primary, out.aes);
+            break;
+        default:
+            return false;
+    }
+    if (!ok || !read_entry_info(zip_file, sel.primary, out.entry)) return false;
+
+    // A cross-check entry that fails to parse is just skipped
+    out.has_cross = cross_check && sel.has_secondary &&
+                    load_zipcrypto_target(zip_file, sel.secondary, out.cross);
+
+    // Encrypted data, loaded once: all of it, or just the probe block if huge
+    bool     whole = out.entry.comp_size <= MAX_PAYLOAD;
+    uint64_t want  = whole ? out.entry.comp_size
+                           : std::min<uint64_t>(out.entry.comp_size, 12 + PROBE_BYTES);
+    out.payload.resize(static_cast<size_t>(want));
+    std::ifstream f(zip_file, std::ios::binary);
+    if (!f.is_open() || !read_at(f, out.entry.data_off, &out.payload[0], out.payload.size()))
+        return false;
+
+    // AES: the HMAC is authoritative. ZipCrypto: CRC32 is, for stored/deflate.
+    out.libzip_final = (enc_method == ZIP_EM_TRAD_PKWARE) &&
+                       (!whole || (out.entry.method != 0 && out.entry.method != 8));
+    return true;
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Known-plaintext attack (Biham–Kocher) on ZipCrypto
+// keystream = plaintext ^ ciphertext. Z-reduction walks the keystream backwards
+// and shrinks the 2^22 candidates for key2[2,32) at the last known byte. Each
+// survivor is extended into 8 consecutive key2 values. Those fix the MSBs of
+// key1, the multiplicative update lifts them to full key1 values, and the
+// LSB(key0) terms that fall out give key0 through CRC32. Survivors are split
+// across threads. The result is the cipher state right after the password, so
+// it decrypts every entry that shares the password; the password is not needed.
+// ══════════════════════════════════════════════════════════════════════════════
+constexpr uint32_t KPA_MULT_INV   = 0xD94FA8CDu;   // 0x08088405^-1 mod 2^32
+constexpr size_t   KPA_MIN_PLAIN  = 12;            // contiguous bytes required
+constexpr size_t   KPA_MAX_PLAIN  = 1 << 20;       // more adds nothing
+constexpr size_t   KPA_ATTACK     = 8;             // key2 values per candidate
+constexpr size_t   KPA_TRACK      = 1 << 16;       // keep reduced lists this small
+constexpr uint32_t KPA_MAXDIFF_24 = (1u << 24) - 1 + 0xFF;
+constexpr uint32_t KPA_MAXDIFF_26 = (1u << 26) - 1 + 0xFF;
+
+struct KpaTables {
+    std::array<uint32_t, 256>                 crcinv{};   // msb(T[j]) -> T[j] << 8 ^ j
+    std::array<std::array<uint16_t, 64>, 256> ks_vals{};  // key2[2,16) giving keystream k
+    std::array<std::array<uint8_t, 65>, 256>  ks_off{};   // ks_vals[k] split by key2[10,16)
+    std::array<uint8_t, 256>                  fib_x{};    // x sorted by msb(x * MULT_INV)
+    std::array<uint16_t, 257>                 fib_off{};
+
+    KpaTables() {
+        for (uint32_t j = 0; j < 256; ++j)
+            crcinv[CRC_TABLE[j] >> 24] = (CRC_TABLE[j] << 8) ^ j;
+
+        // Ascending z keeps each keystream byte's 64 values sorted by bits [10,16)
+        std::array<uint8_t, 256> fill{};
+        for (uint32_t z = 0; z < (1u << 16); z += 4) {
+            uint32_t t = (z | 2) & 0xFFFF;
+            uint8_t  k = static_cast<uint8_t>((t * (t ^ 1)) >> 8);
+            ks_vals[k][fill[k]++] = static_cast<uint16_t>(z);
+        }
+        for (int k = 0; k < 256; ++k) {
+            uint8_t j = 0;
+            for (int hi = 0; hi <= 64; ++hi) {
+                while (j < 64 && (ks_vals[k][j] >> 10) < hi) ++j;
+                ks_off[k][hi] = j;
+            }
+        }
+
+        std::array<uint16_t, 256> count{};
+        for (uint32_t x = 0; x < 256; ++x) ++count[(x * KPA_MULT_INV) >> 24];
+        for (int m = 0; m < 256; ++m) fib_off[m + 1] = fib_off[m] + count[m];
+        std::array<uint16_t, 256> pos{};
+        for (uint32_t x = 0; x < 256; ++x) {
+            uint8_t m = static_cast<uint8_t>((x * KPA_MULT_INV) >> 24);
+            fib_x[fib_off[m] + pos[m]++] = static_cast<uint8_t>(x);
+        }
+    }
+
+    uint32_t crc32inv(uint32_t crc, uint8_t b) const { return (crc << 8) ^ crcinv[crc >> 24] ^ b; }
+};
+
+const KpaTables& kpa_tables() {
+    static const KpaTables t;
+    return t;
+}
+
+inline uint32_t crc32_step(uint32_t crc, uint8_t b) { return (crc >> 8) ^ CRC_TABLE[(crc ^ b) & 0xFF]; }
+
+inline uint8_t kpa_stream(uint32_t z) {
+    uint32_t t = (z | 2) & 0xFFFF;
+    return static_cast<uint8_t>((t * (t ^ 1)) >> 8);
+}
+
+struct KpaInput {
+    std::unique_ptr<uint8_t[]> cipher;          // entry data from the header on
+    size_t                     cipher_len = 0;
+    std::unique_ptr<uint8_t[]> plain;           // contiguous known plaintext
+    std::unique_ptr<uint8_t[]> ks;              // keystream over `plain`
+    size_t                     plain_len  = 0;
+    size_t                     plain_pos  = 0;  // ciphertext index of plain[0]
+    int                        check      = -1; // header byte 11, when known
+};
+
+// Z-reduction from the last keystream byte down to index KPA_ATTACK - 1.
+// Leaves the smallest list seen in `zs` and its keystream index in `index`.
+size_t kpa_reduce(const KpaInput& in, std::unique_ptr<uint32_t[]>& zs, size_t& index) {
+    const KpaTables& T   = kpa_tables();
+    const size_t     cap = 1u << 22;   // each step yields at most 2^22 values
+    std::unique_ptr<uint32_t[]> cur(new uint32_t[cap]), uniq(new uint32_t[cap]), best;
+    std::unique_ptr<uint64_t[]> seen(new uint64_t[cap / 64]);
+
+    index = in.plain_len - 1;
+    uint8_t k = in.ks[index];
+    size_t  n = 0;
+    for (uint32_t hi = 0; hi < cap; ++hi)
+        for (uint8_t j = T.ks_off[k][hi & 63]; j < T.ks_off[k][(hi & 63) + 1]; ++j)
+            cur[n++] = (hi << 10) | (T.ks_vals[k][j] & 0x3FC);
+
+    size_t best_n = n, best_index = index;
+    for (size_t i = index; i >= KPA_ATTACK; --i) {
+        // key2_{i-1}[10,32) follows from key2_i[2,32); keep the ones whose
+        // bits [10,16) can still produce keystream byte i-1
+        k = in.ks[i - 1];
+        std::memset(seen.get(), 0, cap / 8);
+        size_t m = 0;
+        for (size_t c = 0; c < n; ++c) {
+            uint32_t zim1 = T.crc32inv(cur[c], 0) & 0xFFFFFC00;
+            uint32_t hi   = zim1 >> 10;
+            if (T.ks_off[k][hi & 63] == T.ks_off[k][(hi & 63) + 1]) continue;
+            if (seen[hi >> 6] & (1ull << (hi & 63))) continue;
+            seen[hi >> 6] |= 1ull << (hi & 63);
+            uniq[m++] = zim1;
+        }
+        n = 0;
+        for (size_t c = 0; c < m; ++c) {
+            uint32_t h6 = (uniq[c] >> 10) & 63;
+            for (uint8_t j = T.ks_off[k][h6]; j < T.ks_off[k][h6 + 1]; ++j)
+                cur[n++] = uniq[c] | (T.ks_vals[k][j] & 0x3FC);
+        }
+        if (n < best_n && n <= KPA_TRACK) {
+            if (!best) best.reset(new uint32_t[KPA_TRACK]);
+            std::memcpy(best.get(), cur.get(), n * sizeof(uint32_t));
+            best_n = n;
+            best_index = i - 1;
+        }
+    }
+
+    if (best && best_n <= n) {
+        zs    = std::move(best);
+        index = best_index;
+        return best_n;
+    }
+    index = KPA_ATTACK - 1;
+    zs    = std::move(cur);
+    return n;
+}
+
+// One thread's search state: candidate key2 at plaintext index base + 7
+struct KpaSearch {
+    const KpaInput&    in;
+    const KpaTables&   T = kpa_tables();
+    std::atomic<bool>& done;
+    size_t             base = 0;
+    uint32_t           z[KPA_ATTACK] = {}, y[KPA_ATTACK] = {};
+    uint8_t            xl[KPA_ATTACK] = {};     // LSB(key0_i)
+    uint8_t            ymsb[KPA_ATTACK] = {};   // key1_i[24,32), i >= 2
+    uint32_t           y1_26_32 = 0;
+    uint32_t           keys[3] = {};            // at ciphertext index 0
+    bool               found   = false;
+
+    KpaSearch(const KpaInput& input, std::atomic<bool>& d, size_t b) : in(input), done(d), base(b) {}
+
+    void candidate(uint32_t z7) {
+        z[7] = z7;
+        explore_z(7);
+    }
+
+    // key2_{i-1}[2,32) from key2_i and keystream; completes key2_i[0,2) and
+    // yields key1_{i+1}[24,32)
+    void explore_z(int i) {
+        if (i == 0) {
+            y1_26_32 = ((z[0] ^ T.crc32inv(z[1], 0)) & 0xFC) << 24;
+            guess_y7();
+            return;
+        }
+        uint32_t zim1 = T.crc32inv(z[i] & ~3u, 0) & 0xFFFFFC00;
+        uint8_t  k    = in.ks[base + i - 1];
+        uint32_t h6   = (zim1 >> 10) & 63;
+        for (uint8_t j = T.ks_off[k][h6]; j < T.ks_off[k][h6 + 1] && !done.load(std::memory_order_relaxed); ++j) {
+            z[i - 1] = zim1 | (T.ks_vals[k][j] & 0x3FC);
+            z[i]     = (z[i] & ~3u) | (((T.crc32inv(z[i] & ~3u, 0) ^ z[i - 1]) >> 8) & 3);
+            if (i < 7) ymsb[i + 1] = static_cast<uint8_t>(z[i] ^ T.crc32inv(z[i + 1], 0));
+            explore_z(i - 1);
+        }
+    }
+
+    // key1_7[0,24) by brute force over bits [8,24); bits [0,8) come from the
+    // fiber of msb(x * MULT_INV) that can still reach key1_6[24,32)
+    void guess_y7() {
+        const uint32_t h6 = static_cast<uint32_t>(ymsb[6]) << 24;
+        for (uint32_t mid = 0; mid < (1u << 16); ++mid) {
+            uint32_t hi   = (static_cast<uint32_t>(ymsb[7]) << 24) | (mid << 8);
+            uint32_t prod = (hi - 1) * KPA_MULT_INV;
+            uint32_t d    = h6 - prod;
+            for (int s = 0; s <= 2; ++s) {
+                uint8_t m = static_cast<uint8_t>((d >> 24) + s);
+                for (uint16_t j = T.fib_off[m]; j < T.fib_off[m + 1]; ++j) {
+                    uint8_t lo = T.fib_x[j];
+                    if (lo * KPA_MULT_INV - d > KPA_MAXDIFF_24) continue;
+                    y[7] = hi | lo;
+                    explore_y(7);
+                }
+            }
+            if ((mid & 0xFF) == 0 && done.load(std::memory_order_relaxed)) return;
+        }
+    }
+
+    // key1_{i-1} = (key1_i - 1) * MULT_INV - LSB(key0_i); two steps of
+    // look-ahead on key1_{i-2}[24,32) leave ~1 choice of LSB(key0_i)
+    void explore_y(int i) {
+        if (i == 3) { test_x(); return; }
+        uint32_t fy  = (y[i] - 1) * KPA_MULT_INV;
+        uint32_t ffy = (fy - 1) * KPA_MULT_INV;
+        uint32_t d   = ffy - (static_cast<uint32_t>(ymsb[i - 2]) << 24);
+        for (int s = 0; s <= 2; ++s) {
+            uint8_t m = static_cast<uint8_t>((d >> 24) - s);
+            for (uint16_t j = T.fib_off[m]; j < T.fib_off[m + 1]; ++j) {
+                uint8_t x = T.fib_x[j];
+                if (d - x * KPA_MULT_INV > KPA_MAXDIFF_24) continue;
+                uint32_t yim1 = fy - x;
+                if ((yim1 >> 24) != ymsb[i - 1]) continue;
+                y[i - 1] = yim1;
+                xl[i]    = x;
+                explore_y(i - 1);
+            }
+        }
+    }
+
+    // LSB(key0_4..7) + plaintext give key0_7 whole; filter, then confirm
+    void test_x() {
+        const uint8_t* p = in.plain.get() + base;
+        uint32_t x = xl[4];
+        for (int i = 5; i <= 7; ++i) x = (crc32_step(x, p[i - 1]) & 0xFFFFFF00) | xl[i];
+        const uint32_t x7 = x;
+        for (int i = 6; i >= 3; --i) x = T.crc32inv(x, p[i]);
+
+        uint32_t y2 = (y[3] - 1) * KPA_MULT_INV - (x & 0xFF);
+        if ((y2 >> 24) != ymsb[2]) return;
+        if ((y2 - 1) * KPA_MULT_INV - y1_26_32 > KPA_MAXDIFF_26) return;
+
+        // Forward over the rest of the known plaintext
+        uint32_t k0 = x7, k1 = y[7], k2 = z[7];
+        for (size_t j = base + 7; j < in.plain_len; ++j) {
+            if (kpa_stream(k2) != in.ks[j]) return;
+            k0 = crc32_step(k0, in.plain[j]);
+            k1 = (k1 + (k0 & 0xFF)) * 134775813u + 1;
+            k2 = crc32_step(k2, static_cast<uint8_t>(k1 >> 24));
+        }
+
+        // Unwind to the start of the encryption header
+        k0 = x7; k1 = y[7]; k2 = z[7];
+        for (size_t j = in.plain_pos + base + 7; j > 0; --j) {
+            k2 = T.crc32inv(k2, static_cast<uint8_t>(k1 >> 24));
+            k1 = (k1 - 1) * KPA_MULT_INV - (k0 & 0xFF);
+            k0 = T.crc32inv(k0, in.cipher[j - 1] ^ kpa_stream(k2));
+        }
+        if (!kpa_confirm(in, k0, k1, k2)) return;
+
+        keys[0] = k0; keys[1] = k1; keys[2] = k2;
+        found   = true;
+        done.store(true);
+    }
+
+    // Decrypts from the header on and compares every known byte
+    static bool kpa_confirm(const KpaInput& in, uint32_t k0, uint32_t k1, uint32_t k2) {
+        ZipCryptoKeys keys;
+        keys.k0 = k0; keys.k1 = k1; keys.k2 = k2;
+        for (size_t j = 0; j < in.plain_pos + in.plain_len; ++j) {
+            uint8_t c = in.cipher[j] ^ keys.stream_byte();
+            if (j == 11 && in.check >= 0 && c != in.check) return false;
+            if (j >= in.plain_pos && c != in.plain[j - in.plain_pos]) return false;
+            keys.update(c);
+        }
+        return true;
+    }
+};
+
+// Ciphertext prefix and keystream for `plain` found at `offset` in the entry
+// data (negative offsets reach into the 12-byte encryption header)
+bool kpa_load(const std::string& zip_file, const ZipEntryInfo& e, const std::string& plain,
+              long long offset, KpaInput& in) {
+    if (offset < -12 || offset + 12 >= static_cast<long long>(e.comp_size)) return false;
+    uint64_t pos = static_cast<uint64_t>(offset + 12);
+    size_t   len = static_cast<size_t>(std::min<uint64_t>(
+                       {plain.size(), e.comp_size - pos, KPA_MAX_PLAIN}));
+    if (len < KPA_MIN_PLAIN) return false;
+
+    in.cipher_len = static_cast<size_t>(pos) + len;
+    in.cipher.reset(new uint8_t[in.cipher_len]);
+    std::ifstream f(zip_file, std::ios::binary);
+    if (!f.is_open() || !read_at(f, e.data_off, in.cipher.get(), in.cipher_len)) return false;
+
+    in.plain_pos = static_cast<size_t>(pos);
+    in.plain_len = len;
+    in.plain.reset(new uint8_t[len]);
+    in.ks.reset(new uint8_t[len]);
+    for (size_t i = 0; i < len; ++i) {
+        in.plain[i] = static_cast<uint8_t>(plain[i]);
+        in.ks[i]    = in.plain[i] ^ in.cipher[pos + i];
+    }
+    in.check = (e.flags & 0x0008) ? static_cast<uint8_t>(e.mod_time >> 8)
+                                  : static_cast<uint8_t>(e.crc >> 24);
+    return true;
+}
+
+void pin_to_cpu(int i);   // Work pool, below
+
+// Tries the reduced candidates on `threads` pinned threads; fills keys on success
+bool kpa_attack(const KpaInput& in, int threads, uint32_t keys[3]) {
+    std::unique_ptr<uint32_t[]> zs;
+    size_t index = 0;
+    auto   t0    = std::chrono::steady_clock::now();
+    size_t n     = kpa_reduce(in, zs, index);
+    std::cout << "[*] Z-reduction: " << format_number(n) << " key2 candidates at plaintext byte "
+              << index << "\n";
+
+    std::atomic<bool>   done(false);
+    std::atomic<size_t> next(0), tried(0);
+    std::mutex          result_mutex;
+    auto run = [&]() {
+        KpaSearch s(in, done, index + 1 - KPA_ATTACK);
+        for (size_t c; !done.load() && !stop_requested.load() && (c = next.fetch_add(1)) < n; ) {
+            s.candidate(zs[c]);
+            size_t t = tried.fetch_add(1) + 1;
+            if (t % 256 == 0 || t == n) {
+                auto   now = std::chrono::steady_clock::now();
+                double sec = std::chrono::duration<double>(now - t0).count();
+                double eta = sec / t * (n - t);
+                std::lock_guard<std::mutex> lk(progress_mutex);
+                std::cout << "[-] " << std::fixed << std::setprecision(1) << (t * 100.0 / n)
+                          << "% | " << format_number(t) << "/" << format_number(n)
+                          << " candidates | ETA: " << format_time(eta) << "    \r" << std::flush;
+            }
+        }
+        if (s.found) {
+            std::lock_guard<std::mutex> lk(result_mutex);
+            std::memcpy(keys, s.keys, sizeof(s.keys));
+        }
+    };
+
+    std::array<std::thread, MAX_THREADS> pool;
+    for (int i = 0; i < threads; ++i)
+        pool[i] = std::thread([&, i] {
+            pin_to_cpu(i);
+            run();
+        });
+    for (int i = 0; i < threads; ++i) pool[i].join();
+    std::cout << "\r\033[2K";
+    return done.load();
+}
+
+// Relative entry names only; no absolute paths or ".." components
+bool safe_entry_path(const std::string& name) {
+    if (name.empty() || name[0] == '/' || name.find('\\') != std::string::npos) return false;
+    size_t b = 0;
+    while (b <= name.size()) {
+        size_t e = name.find('/', b);
+        if (e == std::string::npos) e = name.size();
+        if (name.compare(b, e - b, "..") == 0 && e - b == 2) return false;
+        b = e + 1;
+    }
+    return true;
+}
+
+// Decrypts every ZipCrypto entry the keys open into out_dir (CRC checked);
+// returns the number of files written
+size_t kpa_extract(const std::string& zip_file, const uint32_t keys[3], const std::string& out_dir) {
+    std::ifstream f(zip_file, std::ios::binary);
+    if (!f.is_open()) return 0;
+    ::mkdir(out_dir.c_str(), 0755);
+
+    std::unique_ptr<unsigned char[]> in(new unsigned char[VERIFY_CHUNK]);
+    std::unique_ptr<unsigned char[]> out(new unsigned char[VERIFY_CHUNK]);
+    size_t written = 0;
+
+    for_each_entry(zip_file, [&](const ZipEntryInfo& e) {
+        if (!(e.flags & 0x0001) || (e.flags & 0x0040) || e.aes_strength) return true;
+        if (e.name.empty() || e.name.back() == '/' || e.comp_size < 12) return true;
+        if (!safe_entry_path(e.name) || (e.method != 0 && e.method != 8)) {
+            std::cout << "\033[1;33m[!] Skipped " << e.name << " (unsafe name or compression "
+                      << e.method << ")\033[0m\n";
+            return true;
+        }
+
+        ZipCryptoKeys k;
+        k.k0 = keys[0]; k.k1 = keys[1]; k.k2 = keys[2];
+        unsigned char hdr[12];
+        if (!read_at(f, e.data_off, hdr, 12)) return true;
+        for (int i = 0; i < 12; ++i) { hdr[i] ^= k.stream_byte(); k.update(hdr[i]); }
+        uint8_t check = (e.flags & 0x0008) ? static_cast<uint8_t>(e.mod_time >> 8)
+                                           : static_cast<uint8_t>(e.crc >> 24);
+        if (hdr[11] != check) {
+            std::cout << "\033[1;33m[!] Keys do not open " << e.name << "\033[0m\n";
+            return true;
+        }
+
+        for (size_t s = e.name.find('/'); s != std::string::npos; s = e.name.find('/', s + 1))
+            ::mkdir((out_dir + "/" + e.name.substr(0, s)).c_str(), 0755);
+        std::string   path = out_dir + "/" + e.name;
+        std::ofstream dst(path, std::ios::binary | std::ios::trunc);
+        z_stream      zs{};
+        if (!dst.is_open() || (e.method == 8 && inflateInit2(&zs, -MAX_WBITS) != Z_OK)) return true;
+
+        uint64_t left = e.comp_size - 12, produced = 0;
+        uint32_t crc  = 0;
+        int      r    = Z_OK;
+        f.clear();
+        f.seekg(static_cast<std::streamoff>(e.data_off + 12));
+        while (left && r != Z_STREAM_END) {
+            size_t chunk = static_cast<size_t>(std::min<uint64_t>(left, VERIFY_CHUNK));
+            if (!f.read(reinterpret_cast<char*>(in.get()), static_cast<std::streamsize>(chunk))) break;
+            left -= chunk;
+            for (size_t i = 0; i < chunk; ++i) { in[i] ^= k.stream_byte(); k.update(in[i]); }
+            if (e.method == 0) {
+                crc = crc32(crc, in.get(), static_cast<uInt>(chunk));
+                dst.write(reinterpret_cast<const char*>(in.get()), static_cast<std::streamsize>(chunk));
+                produced += chunk;
+                continue;
+            }
+            zs.next_in  = in.get();
+            zs.avail_in = static_cast<uInt>(chunk);
+            do {
+                zs.next_out  = out.get();
+                zs.avail_out = static_cast<uInt>(VERIFY_CHUNK);
+                r = inflate(&zs, Z_NO_FLUSH);
+                size_t got = VERIFY_CHUNK - zs.avail_out;
+                crc = crc32(crc, out.get(), static_cast<uInt>(got));
+                dst.write(reinterpret_cast<const char*>(out.get()), static_cast<std::streamsize>(got));
+                produced += got;
+            } while (r == Z_OK && zs.avail_out == 0);
+            if (r != Z_OK && r != Z_STREAM_END && r != Z_BUF_ERROR) break;
+        }
+        if (e.method == 8) inflateEnd(&zs);
+        dst.close();
+
+        if (crc != e.crc || produced != e.uncomp_size) {
+            std::cout << "\033[1;31m[!] CRC mismatch on " << e.name << " — not written\033[0m\n";
+            std::remove(path.c_str());
+            return true;
+        }
+        std::cout << "\033[1;32m[+] Decrypted " << e.name << "\033[0m\n";
+        ++written;
+        return true;
+    });
+    return written;
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Crack targets  —  one or many archives fed by a single candidate stream
+// A normal run has one target. --batch loads every archive's verifier up front;
+// each candidate batch is tested against all targets still unsolved, so
+// generation is paid once however many archives there are. Solved targets drop
+// out, and the run ends when none are left.
+// ══════════════════════════════════════════════════════════════════════════════
+struct CrackTarget {
+    std::string       path;
+    std::string       fingerprint;    // entry_fingerprint: potfile / history key
+    TargetSelection   sel;
+    NativeVerifier    nv;
+    bool              native = false;
+    std::atomic<bool> solved{false};
+    std::atomic<bool> unopenable{false};   // zip_open failed: reported once, not retried
+    std::string       password;       // written once, under password_mutex
+};
+
+std::atomic<size_t> targets_left(0);   // reaching 0 sets password_found
+
+// Marks `t` solved; true if this call did it (another worker may have won)
+bool record_solve(CrackTarget& t, const char* pwd, size_t len) {
+    std::lock_guard<std::mutex> lk(password_mutex);
+    if (t.solved.load(std::memory_order_acquire)) return false;
+    t.password.assign(pwd, len);
+    t.solved.store(true, std::memory_order_release);
+    if (targets_left.fetch_sub(1) == 1) password_found.store(true, std::memory_order_release);
+    return true;
+}
+
+// Archive paths for --batch: one per line, blank lines and '#' comments skipped
+size_t read_batch_list(const std::string& path, std::unique_ptr<std::string[]>& out) {
+    std::ifstream in(path);
+    if (!in.is_open()) return 0;
+    std::string line;
+    size_t lines = 0, n = 0;
+    while (std::getline(in, line)) ++lines;
+    out.reset(new std::string[lines ? lines : 1]);
+    in.clear();
+    in.seekg(0);
+    while (std::getline(in, line)) {
+        while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+        out[n++] = line;
+    }
+    return n;
+}
+
+// Validates one archive and loads its verifier. On failure `why` says what
+// is wrong and the target must be skipped.
+bool prepare_target(const std::string& path, bool cross_check,
+                    CrackTarget& t, std::string& why) {
+    t.path = path;
+    t.sel  = TargetSelection();
+    if (detect_format(path) != "ZIP Archive") { why = "not a ZIP archive"; return false; }
+    bool has_files = false;
+    if (!is_password_protected(path, has_files, t.sel)) {
+        why = has_files ? "not password protected" : "empty archive";
+        return false;
+    }
+    t.native = load_native_verifier(path, t.sel, cross_check, t.nv);
+    return true;
+}
+
+// "index:password" per solved target, for the checkpoint
+std::string solved_list(const CrackTarget* targets, size_t count) {
+    std::lock_guard<std::mutex> lk(password_mutex);
+    std::string s;
+    for (size_t i = 0; i < count; ++i)
+        if (targets[i].solved.load())
+            s += std::to_string(i) + ":" + targets[i].password + "\n";
+    return s;
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Work pool  —  topology-sized, pinned workers with per-thread range deques
+// One worker per CPU the process may use (taskset / cpusets honoured), pinned
+// and numbered socket by socket. Masks and memory-mapped wordlists are index
+// spaces that the workers generate from themselves. A worker takes POOL_SLAB
+// ranges per trip to the shared counter, keeps them in its own deque and
+// works through them lowest first. An idle worker steals the upper half of
+// another deque, trying its own socket before remote ones, so a run's tail
+// and uneven work (rules, joins, mixed batches) balance without a central queue.
+//
+// Checkpoint watermark: each worker's ProgressSlot holds the start of the
+// oldest range it has not finished, its deque included. Before taking
+// ranges, a thief lowers its own slot to the victim's. A reader retries when
+// a steal overlapped its scan, so every unfinished range is always under
+// some slot it reads.
+// ══════════════════════════════════════════════════════════════════════════════
+constexpr uint64_t NO_RANGE = std::numeric_limits<uint64_t>::max();
+
+struct alignas(64) ProgressSlot {
+    std::atomic<uint64_t> low{NO_RANGE};
+};
+std::array<ProgressSlot, MAX_THREADS> progress_slots;
+
+struct CpuTopology {
+    int                          count    = 0;   // usable CPUs
+    int                          packages = 1;   // sockets among them
+    std::array<int, MAX_THREADS> cpu{};          // worker i runs on cpu[i % count]
+    std::array<int, MAX_THREADS> package{};      // socket of cpu[i]
+};
+CpuTopology topology;
+bool        pin_workers = true;   // --no-pin
+
+int read_sys_int(const std::string& path, int fallback) {
+    std::ifstream f(path);
+    int           v;
+    return (f >> v) ? v : fallback;
+}
+
+// Usable CPUs ordered by (socket, core, cpu): consecutive workers share a
+// socket and SMT siblings sit next to each other
+CpuTopology detect_topology() {
+    CpuTopology t;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        std::array<std::array<int, 3>, MAX_THREADS> key;   // socket, core, cpu
+        for (int c = 0; c < CPU_SETSIZE && t.count < MAX_THREADS; ++c) {
+            if (!CPU_ISSET(c, &set)) continue;
+            std::string dir = "/sys/devices/system/cpu/cpu" + std::to_string(c) + "/topology/";
+            key[t.count++] = {read_sys_int(dir + "physical_package_id", 0),
+                              read_sys_int(dir + "core_id", c), c};
+        }
+        std::sort(key.begin(), key.begin() + t.count);
+        for (int i = 0; i < t.count; ++i) {
+            t.cpu[i]     = key[i][2];
+            t.package[i] = key[i][0];
+            if (i && key[i][0] != key[i - 1][0]) ++t.packages;
+        }
+    }
+#endif
+    if (t.count == 0) {   // no affinity API: count only, no pinning
+        unsigned int hw = std::thread::hardware_concurrency();
+        t.count = std::min(MAX_THREADS, hw > 0 ? static_cast<int>(hw) : 4);
+        for (int i = 0; i < t.count; ++i) t.cpu[i] = -1;
+    }
+    return t;
+}
+
+// Called by worker `i` itself, before it touches any memory of its own
+void pin_to_cpu(int i) {
+#ifdef __linux__
+    int cpu = topology.count ? topology.cpu[i % topology.count] : -1;
+    if (!pin_workers || cpu < 0) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)i;
+#endif
+}
+
+class RangePool {
+    struct Range {
+        uint64_t begin, end;
+    };
+    struct alignas(64) Deque {
+        std::mutex                    m;
+        std::array<Range, POOL_SLAB>  r{};
+        size_t                        head = 0;
+        std::atomic<size_t>           count{0};     // peeked by thieves without the lock
+        uint64_t                      held = NO_RANGE;   // owner only: lowest queued begin (may be stale-low)
+    };
+    std::unique_ptr<Deque[]> q_;
+    int                      workers_;
+    std::atomic<uint64_t>    steals_begun_{0}, steals_done_{0};
+    std::atomic<uint64_t>    stolen_{0};   // successful steals
+
+    static void push(Deque& d, uint64_t b, uint64_t e) {
+        size_t n = d.count.load(std::memory_order_relaxed);
+        d.r[(d.head + n) % POOL_SLAB] = {b, e};
+        d.count.store(n + 1, std::memory_order_relaxed);
+    }
+    static void refresh(Deque& d) {
+        d.held = d.count.load(std::memory_order_relaxed) ? d.r[d.head].begin : NO_RANGE;
+    }
+
+    int package(int w) const { return topology.package[w % std::max(1, topology.count)]; }
+
+    bool steal(int id, uint64_t& b, uint64_t& e) {
+        std::atomic<uint64_t>&       mine = progress_slots[id].low;
+        std::array<Range, POOL_SLAB> got;
+        for (int pass = 0; pass < 2; ++pass) {
+            for (int k = 1; k < workers_; ++k) {
+                int v = (id + k) % workers_;
+                if ((package(v) == package(id)) != (pass == 0)) continue;
+                Deque& vd = q_[v];
+                if (!vd.count.load(std::memory_order_relaxed)) continue;
+
+                size_t n = 0;
+                steals_begun_.fetch_add(1);
+                {
+                    std::lock_guard<std::mutex> lk(vd.m);
+                    size_t have = vd.count.load(std::memory_order_relaxed);
+                    if (have) {
+                        // Victim's slot is at or below all it holds: cover that first
+                        uint64_t lv = progress_slots[v].low.load();
+                        if (lv < mine.load(std::memory_order_relaxed)) mine.store(lv);
+                        n = (have + 1) / 2;   // upper half; the victim keeps its lowest
+                        for (size_t i = 0; i < n; ++i) got[i] = vd.r[(vd.head + have - n + i) % POOL_SLAB];
+                        vd.count.store(have - n, std::memory_order_relaxed);
+                    }
+                }
+                steals_done_.fetch_add(1);
+                if (!n) continue;
+                stolen_.fetch_add(1, std::memory_order_relaxed);
+
+                Deque& d = q_[id];
+                std::lock_guard<std::mutex> lk(d.m);
+                b = got[0].begin;
+                e = got[0].end;
+                for (size_t i = 1; i < n; ++i) push(d, got[i].begin, got[i].end);
+                refresh(d);
+                return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    explicit RangePool(int workers) : q_(new Deque[workers]), workers_(workers) {}
+
+    // Lowest range still queued for `id` (its slot must not rise above it)
+    uint64_t held(int id) const { return q_[id].held; }
+    uint64_t steals()     const { return stolen_.load(); }
+
+    // Next range for worker `id`: own deque, else a fresh slab, else a steal.
+    // May lower progress_slots[id]; false once the keyspace is exhausted.
+    template<class Source>
+    bool next(int id, Source& src, uint64_t& b, uint64_t& e) {
+        Deque& d = q_[id];
+        {
+            std::lock_guard<std::mutex> lk(d.m);
+            size_t n = d.count.load(std::memory_order_relaxed);
+            if (n) {
+                b = d.r[d.head].begin;
+                e = d.r[d.head].end;
+                d.head = (d.head + 1) % POOL_SLAB;
+                d.count.store(n - 1, std::memory_order_relaxed);
+                refresh(d);
+                return true;
+            }
+            d.held = NO_RANGE;
+        }
+        uint64_t sb, se;
+        if (src.claim(sb, se, POOL_SLAB)) {
+            const uint64_t unit = src.chunk();
+            std::lock_guard<std::mutex> lk(d.m);
+            b = sb;
+            e = std::min(se, sb + unit);
+            for (uint64_t x = e; x < se; x += unit) push(d, x, std::min(se, x + unit));
+            refresh(d);
+            return true;
+        }
+        return steal(id, b, e);
+    }
+
+    // Everything below this has been verified. `next` is read first: a slab
+    // claimed after that load starts at or above it.
+    template<class Source>
+    uint64_t watermark(const Source& src) const {
+        for (;;) {
+            uint64_t done  = steals_done_.load();
+            uint64_t begun = steals_begun_.load();
+            if (begun != done) { std::this_thread::yield(); continue; }
+            uint64_t w = src.next_unclaimed();
+            for (int i = 0; i < workers_; ++i) w = std::min(w, progress_slots[i].low.load());
+            if (steals_begun_.load() == begun) return w;
+        }
+    }
+};
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Live statistics  —  per-worker counters, one reporter thread
+// Each worker owns a cache-line-aligned slot and is its only writer (plain
+// load + store, no locked RMW, no shared line). The reporter samples every
+// slot each tick and does all progress output: the TTY line, JSON lines
+// (--stats-json) and cracked-archive notices, so workers never touch stdout.
+// Generate/check time is measured on 1 batch in STATS_SAMPLE and scaled;
+// the rare verify/libzip calls are always timed.
+// ══════════════════════════════════════════════════════════════════════════════
+enum TimePhase { TIME_GENERATE = 0, TIME_CHECK, TIME_VERIFY, TIME_LIBZIP, TIME_COUNT };
+constexpr const char* TIME_NAMES[TIME_COUNT]   = {"generate", "check", "verify", "libzip"};
+constexpr const char* STAGE_KEYS[STAGE_COUNT] = {"check", "cross", "probe", "full"};
+
+struct alignas(64) WorkerStats {
+    std::atomic<uint64_t>                          attempts{0};
+    std::array<std::atomic<uint64_t>, STAGE_COUNT> rejects{};
+    std::array<std::atomic<uint64_t>, TIME_COUNT>  nanos{};
+};
+std::array<WorkerStats, MAX_THREADS> worker_stats;
+uint64_t    attempts_resumed = 0;   // carried over from a checkpoint
+uint64_t    attempts_remote  = 0;   // coordinator: reported by the nodes
+std::string stats_json_path;        // --stats-json: file, or "-" for stdout
+double      stats_interval   = 1.0; // --stats-interval: seconds between JSON lines
+
+// Single-writer increment: the owning worker is the only one storing
+inline void stat_add(std::atomic<uint64_t>& c, uint64_t n) {
+    c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+inline uint64_t stats_clock() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t attempts_total(int workers = MAX_THREADS) {
+    uint64_t n = attempts_resumed + attempts_remote;
+    for (int i = 0; i < workers; ++i) n += worker_stats[i].attempts.load(std::memory_order_relaxed);
+    return n;
+}
+
+uint64_t stage_total(int stage, int workers = MAX_THREADS) {
+    uint64_t n = 0;
+    for (int i = 0; i < workers; ++i) n += worker_stats[i].rejects[stage].load(std::memory_order_relaxed);
+    return n;
+}
+
+uint64_t phase_total(int phase, int workers = MAX_THREADS) {
+    uint64_t n = 0;
+    for (int i = 0; i < workers; ++i) n += worker_stats[i].nanos[phase].load(std::memory_order_relaxed);
+    return n;
+}
+
+// Samples the slots every STATS_TICK_MS until `done`, then reports once more
+void stats_reporter(int workers, const CrackTarget* targets, size_t target_count,
+                    std::chrono::steady_clock::time_point start_time,
+                    const std::atomic<bool>& done) {
+    std::ofstream json_file;
+    std::ostream* json = nullptr;
+    if (stats_json_path == "-") {
+        json = &std::cout;
+    } else if (!stats_json_path.empty()) {
+        json_file.open(stats_json_path, std::ios::app);
+        if (json_file.is_open()) json = &json_file;
+        else std::cout << "\033[1;33m[!] Cannot write " << stats_json_path
+                       << " — JSON stats disabled\033[0m\n";
+    }
+    const bool tty = (json != &std::cout);
+
+    std::array<uint64_t, MAX_THREADS> last_worker{};   // per-worker count at the last JSON line
+    std::unique_ptr<bool[]> announced(new bool[target_count]);   // potfile hits: already shown
+    for (size_t i = 0; i < target_count; ++i) announced[i] = targets[i].solved.load();
+    size_t   left      = targets_left.load();
+    uint64_t last_n    = attempts_resumed;
+    double   last_t    = 0, last_json = 0, rate = 0;
+    bool     finishing = false;
+    while (!finishing) {
+        finishing = done.load();
+        if (!finishing) std::this_thread::sleep_for(std::chrono::milliseconds(STATS_TICK_MS));
+
+        double   t   = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        uint64_t cur = attempts_total(workers);
+        size_t   tot = total_passwords.load(std::memory_order_relaxed);
+        if (t > last_t) {
+            double inst = (cur - last_n) / (t - last_t);
+            rate = (last_t == 0) ? inst : 0.3 * inst + 0.7 * rate;   // smoothed for the ETA
+        }
+        double eta = (rate > 0 && tot > cur) ? (tot - cur) / rate : 0;
+
+        // Cracked archives in a batch, announced as they fall
+        for (size_t i = 0; target_count > 1 && i < target_count; ++i) {
+            if (announced[i] || !targets[i].solved.load(std::memory_order_acquire)) continue;
+            announced[i] = true;
+            std::cout << "\33[2K\r\033[1;32m[+] " << targets[i].path << ": "
+                      << targets[i].password << "\033[0m (" << --left
+                      << " left)\n" << std::flush;
+        }
+
+        if (tty && !finishing && cur > 0) {
+            if (tot > 0) {
+                std::cout << "[-] " << std::fixed << std::setprecision(1)
+                          << (cur * 100.0) / tot << "% | "
+                          << format_number(cur) << "/" << format_number(tot)
+                          << " | " << std::setprecision(0) << rate
+                          << " pwd/s | ETA: " << format_time(eta)
+                          << "    \r" << std::flush;
+            } else {
+                std::cout << "[-] Attempts: " << format_number(cur)
+                          << " | " << std::fixed << std::setprecision(0) << rate
+                          << " pwd/s    \r" << std::flush;
+            }
+        }
+
+        if (json && (finishing || t - last_json >= stats_interval)) {
+            double span = t - last_json;
+            std::ostringstream line;
+            line << std::fixed << std::setprecision(3)
+                 << "{\"t\":" << t << ",\"attempts\":" << cur << ",\"total\":" << tot
+                 << std::setprecision(1) << ",\"rate\":" << rate
+                 << ",\"avg_rate\":" << (t > 0 ? (cur - attempts_resumed) / t : 0.0)
+                 << ",\"eta\":" << eta << ",\"targets_left\":" << targets_left.load()
+                 << ",\"worker_rate\":[";
+            for (int i = 0; i < workers; ++i) {
+                uint64_t w = worker_stats[i].attempts.load(std::memory_order_relaxed);
+                line << (i ? "," : "") << (span > 0 ? (w - last_worker[i]) / span : 0.0);
+                last_worker[i] = w;
+            }
+            line << "],\"rejects\":{";
+            for (int s = 0; s < STAGE_COUNT; ++s)
+                line << (s ? "," : "") << '"' << STAGE_KEYS[s] << "\":" << stage_total(s, workers);
+            line << "},\"time_ms\":{";
+            for (int p = 0; p < TIME_COUNT; ++p)
+                line << (p ? "," : "") << '"' << TIME_NAMES[p] << "\":" << phase_total(p, workers) / 1000000;
+            line << "},\"done\":" << (finishing ? "true" : "false") << "}\n";
+            *json << line.str() << std::flush;
+            last_json = t;
+        }
+        last_n = cur;
+        last_t = t;
+    }
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Checkpoint / resume
+// The saved position is RangePool::watermark(): every candidate below it has
+// been verified. Files are replaced atomically (tmp + rename).
+// ══════════════════════════════════════════════════════════════════════════════
+struct Checkpoint {
+    std::string archive;           // archive, or the archive list with --batch
+    bool        batch       = false;
+    std::string fingerprint;       // batch: one per archive, comma-separated
+    std::string solved;            // batch: "index:password" lines
+    int         mode        = 0;   // 2 = mask (index); 1, 5-7 = wordlist (byte offset)
+    std::string target;            // wordlist path or mask pattern
+    std::string rules;             // rule file applied to the wordlist, if any
+    std::string part;              // hybrid mask or combinator second wordlist
+    std::array<std::string, 4> charsets;   // mask: -1..-4 definitions as given
+    size_t      inc_min     = 0;   // mask: --increment bounds (0 = off)
+    size_t      inc_max     = 0;
+    std::string markov;            // mask: Markov training wordlist
+    double      markov_threshold = 0;
+    uint64_t    target_size = 0;   // wordlist bytes or mask keyspace
+    uint64_t    position    = 0;   // low-watermark of completed work
+    uint64_t    attempts    = 0;
+};
+
+// Identity of an encrypted entry: CRC, compressed size and the leading bytes
+// of its encrypted data (ZipCrypto header / AES salt). Survives repacking the
+// archive around it, so it keys the potfile and session history.
+std::string entry_fingerprint(const std::string& zip_file, uint64_t index) {
+    ZipEntryInfo info;
+    if (!read_entry_info(zip_file, index, info)) return "";
+
+    std::ifstream f(zip_file, std::ios::binary);
+    unsigned char head[16] = {0};
+    size_t n = static_cast<size_t>(std::min<uint64_t>(sizeof(head), info.comp_size));
+    if (!f.is_open() || !read_at(f, info.data_off, head, n)) return "";
+
+    std::ostringstream os;
+    os << std::hex << info.crc << ':' << info.comp_size << ':';
+    for (size_t i = 0; i < n; ++i)
+        os << std::setw(2) << std::setfill('0') << static_cast<int>(head[i]);
+    return os.str();
+}
+
+// Identity of the target for checkpoints: file size plus the entry fingerprint
+std::string archive_fingerprint(const std::string& zip_file, uint64_t index) {
+    std::string entry = entry_fingerprint(zip_file, index);
+    struct stat st;
+    if (entry.empty() || ::stat(zip_file.c_str(), &st) != 0) return "";
+    std::ostringstream os;
+    os << std::hex << static_cast<uint64_t>(st.st_size) << ':' << entry;
+    return os.str();
+}
+
+// Checkpoint as text; also the attack spec sent to distributed nodes
+std::string checkpoint_text(const Checkpoint& ck) {
+    std::ostringstream out;
+    out << "zip_cracker checkpoint v1\n"
+        << "archive="     << ck.archive     << "\n"
+        << "batch="       << ck.batch       << "\n"
+        << "fingerprint=" << ck.fingerprint << "\n"
+        << "mode="        << ck.mode        << "\n"
+        << "target="      << ck.target      << "\n"
+        << "target_size=" << ck.target_size << "\n"
+        << "position="    << ck.position    << "\n"
+        << "attempts="    << ck.attempts    << "\n"
+        << "rules="       << ck.rules       << "\n"
+        << "part="        << ck.part        << "\n";
+    for (int c = 0; c < 4; ++c)
+        out << "charset" << c + 1 << "=" << ck.charsets[c] << "\n";
+    out << "increment="   << ck.inc_min << ":" << ck.inc_max << "\n"
+        << "markov="      << ck.markov  << "\n"
+        << "markov_threshold=" << ck.markov_threshold << "\n";
+    std::istringstream solved(ck.solved);
+    std::string        entry;
+    while (std::getline(solved, entry))
+        out << "solved=" << entry << "\n";
+    return out.str();
+}
+
+bool save_checkpoint(const std::string& path, const Checkpoint& ck) {
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out.is_open()) return false;
+        out << checkpoint_text(ck);
+        out.flush();
+        if (!out) return false;
+    }
+    // Data must be on disk before the rename makes it the live checkpoint
+    int fd = ::open(tmp.c_str(), O_RDONLY);
+    if (fd >= 0) { fsync(fd); ::close(fd); }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+bool parse_checkpoint(std::istream& in, Checkpoint& ck) {
+    std::string line;
+    if (!std::getline(in, line) || line != "zip_cracker checkpoint v1")
+        return false;
+    try {
+        while (std::getline(in, line)) {
+            size_t eq = line.find('=');
+            if (eq == std::string::npos) continue;
+            std::string key = line.substr(0, eq), val = line.substr(eq + 1);
+            if      (key == "archive")     ck.archive     = val;
+            else if (key == "batch")       ck.batch       = (val == "1");
+            else if (key == "solved")      ck.solved     += val + "\n";
+            else if (key == "fingerprint") ck.fingerprint = val;
+            else if (key == "mode")        ck.mode        = std::stoi(val);
+            else if (key == "target")      ck.target      = val;
+            else if (key == "target_size") ck.target_size = std::stoull(val);
+            else if (key == "position")    ck.position    = std::stoull(val);
+            else if (key == "attempts")    ck.attempts    = std::stoull(val);
+            else if (key == "rules")       ck.rules       = val;
+            else if (key == "part")        ck.part        = val;
+            else if (key == "markov")      ck.markov      = val;
+            else if (key == "markov_threshold") ck.markov_threshold = std::stod(val);
+            else if (key.size() == 8 && key.compare(0, 7, "charset") == 0 &&
+                     key[7] >= '1' && key[7] <= '4')
+                ck.charsets[key[7] - '1'] = val;
+            else if (key == "increment") {
+                size_t colon = val.find(':');
+                ck.inc_min = std::stoull(val.substr(0, colon));
+                ck.inc_max = std::stoull(val.substr(colon + 1));
+            }
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    return !ck.archive.empty() && (ck.mode == 1 || ck.mode == 2 || (ck.mode >= 5 && ck.mode <= 7));
+}
+
+bool load_checkpoint(const std::string& path, Checkpoint& ck) {
+    std::ifstream in(path);
+    return in.is_open() && parse_checkpoint(in, ck);
+}
+
+// Writes `ck` every CHECKPOINT_SECS until `done`; sleeps in short steps so
+// shutdown is not delayed
+void checkpointer(const std::string& path, Checkpoint ck,
+                  MaskKeyspace* mask, MappedWordlist* words, const RangePool* pool, int workers,
+                  const CrackTarget* targets, size_t target_count,
+                  const std::atomic<bool>& done) {
+    auto last = std::chrono::steady_clock::now();
+    while (!done.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto now = std::chrono::steady_clock::now();
+        if (now - last < std::chrono::seconds(CHECKPOINT_SECS)) continue;
+        last = now;
+
+        ck.position = mask ? pool->watermark(*mask) : pool->watermark(*words);
+        ck.attempts = attempts_total(workers);
+        if (ck.batch) ck.solved = solved_list(targets, target_count);
+        save_checkpoint(path, ck);
+    }
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Potfile and session history  —  what earlier runs already paid for
+// Both are append-only text files keyed by the entry fingerprint.
+// Potfile:  <fingerprint>:<password>  (password = everything after the 3rd ':')
+// History:  <fingerprint> TAB <attack key> TAB <position> — every candidate of
+// that attack below `position` has been tried. The attack key hashes what
+// fixes the candidate order (mode, inputs and their sizes/mtimes, mask
+// options), so a history position means the same thing as a checkpoint one.
+// ══════════════════════════════════════════════════════════════════════════════
+std::string potfile_path;   // empty: --no-potfile
+
+std::string default_state_path(const char* name) {
+    const char* home = std::getenv("HOME");
+    return home ? std::string(home) + "/" + name : std::string(name);
+}
+
+// Full check of one password (native stages, then libzip if they cannot decide)
+bool confirm_password(const CrackTarget& t, const std::string& pwd) {
+    if (!t.native) return test_single_password(t.path, t.sel.primary, pwd);
+    const char*   p   = pwd.c_str();
+    uint32_t      len = static_cast<uint32_t>(pwd.size());
+    VerifyScratch vs;
+    if (!(t.nv.check(&p, &len, 1) & 1) || t.nv.verify(p, len, vs) != STAGE_COUNT) return false;
+    return !t.nv.libzip_final || test_single_password(t.path, t.sel.primary, pwd);
+}
+
+// First potfile password for `t` that still opens it (stale lines are ignored)
+bool potfile_find(const CrackTarget& t, std::string& pwd) {
+    std::ifstream in(potfile_path);
+    std::string   line;
+    while (std::getline(in, line)) {
+        if (line.size() <= t.fingerprint.size() ||
+            line.compare(0, t.fingerprint.size(), t.fingerprint) != 0 ||
+            line[t.fingerprint.size()] != ':')
+            continue;
+        std::string cand = line.substr(t.fingerprint.size() + 1);
+        if (confirm_password(t, cand)) { pwd = cand; return true; }
+    }
+    return false;
+}
+
+void potfile_add(const CrackTarget& t) {
+    if (potfile_path.empty() || t.fingerprint.empty()) return;
+    std::lock_guard<std::mutex> lk(password_mutex);
+    std::ofstream out(potfile_path, std::ios::app);
+    out << t.fingerprint << ':' << t.password << "\n";
+}
+
+// FNV-1a of everything that defines the candidate sequence
+std::string attack_key(const Checkpoint& ck) {
+    std::ostringstream os;
+    os << ck.mode << '\n' << ck.target << '\n' << ck.target_size << '\n'
+       << ck.rules << '\n' << ck.part << '\n' << ck.inc_min << ':' << ck.inc_max << '\n'
+       << ck.markov << '\n' << ck.markov_threshold << '\n';
+    for (const std::string& c : ck.charsets) os << c << '\n';
+    for (const std::string* f : {&ck.target, &ck.rules, &ck.part, &ck.markov}) {
+        struct stat st;
+        if (!f->empty() && ::stat(f->c_str(), &st) == 0)
+            os << st.st_size << '@' << st.st_mtime << '\n';
+    }
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned char c : os.str()) h = (h ^ c) * 0x100000001b3ull;
+    std::ostringstream hex;
+    hex << std::hex << std::setw(16) << std::setfill('0') << h;
+    return hex.str();
+}
+
+// Highest recorded position for (fingerprint, attack); 0 if none
+uint64_t history_done(const std::string& path, const std::string& fp, const std::string& key) {
+    std::ifstream in(path);
+    std::string   line;
+    uint64_t      done = 0;
+    std::string   prefix = fp + "\t" + key + "\t";
+    while (std::getline(in, line))
+        if (line.compare(0, prefix.size(), prefix) == 0)
+            done = std::max<uint64_t>(done, std::strtoull(line.c_str() + prefix.size(), nullptr, 10));
+    return done;
+}
+
+void history_record(const std::string& path, const std::string& fp,
+                    const std::string& key, uint64_t position) {
+    std::ofstream out(path, std::ios::app);
+    out << fp << '\t' << key << '\t' << position << "\n";
+}
+
+extern "C" void on_stop_signal(int) { stop_requested.store(true); }
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Worker thread  —  pulls passwords from the shared queue (dynamic balancing)
+// ══════════════════════════════════════════════════════════════════════════════
+void worker(int id, CandidateChannel* channel,
+            MaskKeyspace* mask,
+            MappedWordlist* words,
+            RangePool* pool,
+            const RuleSet* rules,
+            const CrossPart* part,
+            CrackTarget* targets,
+            size_t target_count) {
+    WorkerStats& st = worker_stats[id];
+
+    // libzip handles, opened on first use: native checks settle most targets
+    // alone, and a large batch would otherwise hold cores × archives files open
+    std::unique_ptr<zip_t*[]> arcs(new zip_t*[target_count]());
+    // An archive libzip cannot open is reported by the first worker to try
+    // and skipped by every worker from then on.
+    auto libzip_accepts = [&](size_t t, const char* pwd, uint32_t len) {
+        if (!arcs[t]) {
+            if (targets[t].unopenable.load(std::memory_order_relaxed)) return false;
+            int err;
+            arcs[t] = zip_open(targets[t].path.c_str(), ZIP_RDONLY, &err);
+            if (!arcs[t]) {
+                if (!targets[t].unopenable.exchange(true)) {
+                    std::lock_guard<std::mutex> lk(progress_mutex);
+                    std::cerr << "\n[!] Worker " << id << " failed to open "
+                              << targets[t].path << " (error: " << err << ")\n";
+                }
+                return false;
+            }
+        }
+        return libzip_verify(arcs[t], targets[t].sel.primary, std::string(pwd, len));
+    };
+
+    // One batch = one pass of the multi-lane kernels: the narrowest native
+    // kernel sets the width (1 lane when no target has a native check).
+    // ptrs/lens point into the mask lane slots or straight into a block.
+    int lanes = 0;
+    for (size_t t = 0; t < target_count; ++t)
+        if (targets[t].native) lanes = lanes ? std::min(lanes, targets[t].nv.lanes()) : targets[t].nv.lanes();
+    if (!lanes) lanes = 1;
+    std::array<const char*, ZC_MAX_LANES>  ptrs{};
+    std::array<uint32_t, ZC_MAX_LANES>     lens{};
+    std::unique_ptr<char[]> lane_buf(mask ? new char[ZC_MAX_LANES * MASK_LANE] : nullptr);
+    for (int k = 0; mask && k < ZC_MAX_LANES; ++k) ptrs[k] = lane_buf.get() + k * MASK_LANE;
+
+    // Wordlist block being consumed (batches never straddle two blocks)
+    CandidateBlock* blk = nullptr;
+    size_t          off = 0;
+
+    // Base-word expansion through rules or a hybrid / combinator part: the
+    // word being expanded, what is left of it, and per-lane outputs.
+    // `base` points into the mapping or into `blk`, which stays held until done.
+    const bool              expanding = rules || part;
+    std::string_view        base;
+    size_t                  rule_i = 0, rule_end = 0;
+    uint64_t                part_left = 0;
+    std::string             part_cur;
+    std::array<uint32_t, MAX_MASK_LEN> part_digits{};
+    MappedWordlist::Cursor  part_wc;
+    std::unique_ptr<char[]> rule_buf(rules ? new char[ZC_MAX_LANES * RULE_MAX_LEN] : nullptr);
+    std::unique_ptr<char[]> join_buf(part ? new char[ZC_MAX_LANES * JOIN_MAX_LEN] : nullptr);
+    auto pending  = [&] { return rule_i < rule_end || part_left > 0; };
+    auto set_base = [&](std::string_view w) {
+        base = w;
+        if (rules) { rule_i = 0; rule_end = rules->count(); return; }
+        part_left = part->size;
+        if (part->mask) part->mask->seek(0, part_cur, part_digits.data());
+        else            part->words->seek(0, part->words->size(), part_wc);
+    };
+    auto expand = [&](int& n) {
+        int   len;
+        char* dst;
+        if (rules) {
+            dst = rule_buf.get() + n * RULE_MAX_LEN;
+            len = apply_rule((*rules)[rule_i++], base.data(), base.size(), dst);
+        } else {
+            std::string_view piece = part_cur;
+            if (part->words && !part->words->next(part_wc, piece)) { part_left = 0; return; }
+            dst = join_buf.get() + n * JOIN_MAX_LEN;
+            len = join_part(base, piece, part->before, dst);
+            if (--part_left && part->mask) part->mask->step(part_cur, part_digits.data());
+        }
+        if (len > 0) { ptrs[n] = dst; lens[n] = static_cast<uint32_t>(len); ++n; }
+    };
+
+    // Staged verification state
+    VerifyScratch scratch;
+    uint64_t      batch_no = 0;
+
+    // Mapped wordlist: current byte range
+    MappedWordlist::Cursor wc;
+    bool                   in_range = false;
+
+    // Mask odometer: current claimed range and the candidate at `pos`
+    uint64_t    pos = 0, end = 0;
+    std::string cur;
+    std::array<uint32_t, MAX_MASK_LEN> digits{};
+
+    // Checkpoint slot: start of the oldest range with unverified candidates,
+    // ranges still queued in this worker's deque included. A range taken
+    // mid-batch is published with the next batch; a steal may lower the slot.
+    std::atomic<uint64_t>& low         = progress_slots[id].low;
+    uint64_t               range_begin = 0;
+    uint64_t               published   = NO_RANGE;
+    auto publish = [&](uint64_t v) {
+        v = std::min(v, pool->held(id));
+        if (v != published) low.store(published = v);
+    };
+    auto take = [&](auto& src, uint64_t& b, uint64_t& e) {
+        bool ok   = pool->next(id, src, b, e);
+        published = low.load(std::memory_order_relaxed);
+        return ok;
+    };
+
+    while (!password_found.load(std::memory_order_acquire) &&
+           !stop_requested.load(std::memory_order_relaxed)) {
+        const bool sample = (++batch_no % STATS_SAMPLE) == 0;
+        uint64_t   t0     = sample ? stats_clock() : 0;
+        int n = 0;
+        if (mask) {
+            if (pos < end) publish(range_begin);
+            while (n < lanes) {
+                if (pos == end) {
+                    if (n == 0) publish(mask->next_unclaimed());
+                    if (!take(*mask, pos, end)) break;
+                    if (n == 0) publish(pos);
+                    range_begin = pos;
+                    mask->seek(pos, cur, digits.data());
+                }
+                n += mask->emit(pos, end, cur, digits.data(), lane_buf.get() + n * MASK_LANE,
+                                lens.data() + n, lanes - n);
+            }
+        } else if (words) {
+            std::string_view line;
+            if (in_range) publish(range_begin);
+            while (n < lanes) {
+                if (pending()) { expand(n); continue; }
+                if (!in_range) {
+                    uint64_t b, e;
+                    if (n == 0) publish(words->next_unclaimed());
+                    if (!take(*words, b, e)) break;
+                    if (n == 0) publish(b);
+                    range_begin = b;
+                    words->seek(b, e, wc);
+                    in_range = true;
+                }
+                if (!words->next(wc, line)) { in_range = false; continue; }
+                if (expanding) { set_base(line); continue; }
+                ptrs[n] = line.data();
+                lens[n] = static_cast<uint32_t>(line.size());
+                ++n;
+            }
+        } else if (!expanding) {
+            if (blk && off >= blk->used) { channel->release(blk); blk = nullptr; }
+            if (!blk) { blk = channel->take(); off = 0; }
+            while (blk && n < lanes && blk->next(off, ptrs[n], lens[n])) ++n;
+        } else {
+            while (n < lanes) {
+                if (pending()) { expand(n); continue; }
+                if (blk && off >= blk->used) { channel->release(blk); blk = nullptr; }
+                if (!blk) {
+                    if (!(blk = channel->take())) break;
+                    off = 0;
+                }
+                const char* w;
+                uint32_t    wl;
+                if (!blk->next(off, w, wl)) continue;
+                set_base(std::string_view(w, wl));
+            }
+        }
+        if (n == 0) { publish(NO_RANGE); break; }   // keyspace exhausted
+
+        stat_add(st.attempts, n);
+        uint64_t t1 = sample ? stats_clock() : 0;
+        if (sample) stat_add(st.nanos[TIME_GENERATE], (t1 - t0) * STATS_SAMPLE);
+
+        // Per unsolved target: stage 1 batched; later stages only for
+        // survivors, libzip last (if needed)
+        for (size_t t = 0; t < target_count; ++t) {
+            CrackTarget& tg = targets[t];
+            if (tg.solved.load(std::memory_order_acquire)) continue;
+            const NativeVerifier* nv = tg.native ? &tg.nv : nullptr;
+
+            uint32_t survivors = (1u << n) - 1;
+            if (nv) {
+                uint64_t c0 = sample ? stats_clock() : 0;
+                survivors = nv->check(ptrs.data(), lens.data(), n);
+                if (sample) stat_add(st.nanos[TIME_CHECK], (stats_clock() - c0) * STATS_SAMPLE);
+            }
+            stat_add(st.rejects[STAGE_CHECK], n - __builtin_popcount(survivors));
+
+            for (int j = 0; j < n && survivors; ++j) {
+                if (!(survivors & (1u << j))) continue;
+                if (nv) {
+                    uint64_t v0    = stats_clock();
+                    int      stage = nv->verify(ptrs[j], lens[j], scratch);
+                    stat_add(st.nanos[TIME_VERIFY], stats_clock() - v0);
+                    if (stage != STAGE_COUNT) { stat_add(st.rejects[stage], 1); continue; }
+                }
+                if (!nv || nv->libzip_final) {
+                    uint64_t l0 = stats_clock();
+                    bool     ok = libzip_accepts(t, ptrs[j], lens[j]);
+                    stat_add(st.nanos[TIME_LIBZIP], stats_clock() - l0);
+                    if (!ok) { stat_add(st.rejects[STAGE_FULL], 1); continue; }
+                }
+
+                if (record_solve(tg, ptrs[j], lens[j])) potfile_add(tg);   // reporter announces it
+                break;
+            }
+        }
+        if (password_found.load(std::memory_order_acquire)) {
+            if (channel) channel->close();   // wake producer + other workers
+            break;
+        }
+    }
+
+    // Interrupted: unblock a streaming producer waiting for free blocks
+    if (stop_requested.load() && channel) channel->close();
+    for (size_t t = 0; t < target_count; ++t)
+        if (arcs[t]) zip_close(arcs[t]);
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Wordlist producer  —  streams passwords from file into candidate blocks
+// Fallback for pipes, stdin ("-") and compressed files; plain regular files
+// are memory-mapped instead. Compressed input is inflated by WordlistStream's
+// decoder thread(s) one stage ahead of this loop.
+// Author: Zakaria | Logic: sequential stream with atomic stop-flag
+// ══════════════════════════════════════════════════════════════════════════════
+// `amplify` = candidates per line (rule count; workers do the expansion)
+void wordlist_producer(const std::string& path, CandidateChannel& channel, size_t amplify,
+                       int threads) {
+    FILE* f = (path == "-") ? stdin : std::fopen(path.c_str(), "rb");
+    if (!f) {
+        std::cerr << "\033[1;31m[!] ERROR: Cannot open wordlist file\033[0m\n";
+        channel.producer_done();
+        return;
+    }
+    WordlistStream in(f, threads);
+
+    CandidateBlock* blk = channel.acquire();
+    if (blk) for_each_line(in, [&](const char* line, size_t len) {
+        if (password_found.load(std::memory_order_acquire) ||
+            stop_requested.load(std::memory_order_relaxed))
+            return false;
+        if (len > MAX_CANDIDATE || blk->add(line, len)) return true;
+
+        // Block full — hand it over and start the next one
+        total_passwords.fetch_add(blk->count * amplify, std::memory_order_relaxed);
+        if (!channel.publish(blk) || !(blk = channel.acquire())) { blk = nullptr; return false; }
+        blk->add(line, len);
+        return true;
+    });
+    if (blk) {
+        total_passwords.fetch_add(blk->count * amplify, std::memory_order_relaxed);
+        if (blk->count == 0 || !channel.publish(blk)) channel.release(blk);
+    }
+    if (in.failed()) wordlist_failed.store(true);
+    if (in.failed() && compression_missing(in.compression()))
+        std::cerr << "\n\033[1;31m[!] ERROR: " << compression_name(in.compression())
+                  << " wordlist on stdin but support not compiled in (rebuild with "
+                  << compression_missing(in.compression()) << ")\033[0m\n";
+    else if (in.failed())
+        std::cerr << "\n\033[1;31m[!] ERROR: " << compression_name(in.compression())
+                  << " wordlist is corrupt or truncated — stopped early\033[0m\n";
+    channel.producer_done();
+}
+
+// ══════════════════════════════════════════════════════════════════════════════
+// Distributed mode  —  a coordinator leases keyspace slices to worker nodes
+// The coordinator (--serve) runs the usual setup, then splits the mask index
+// space or the wordlist's byte (entry) space into leases instead of starting
+// workers. A node (--connect) receives the attack as checkpoint text, builds
+// it from the same files (fingerprints must match) and runs its own pool on
+// one lease at a time through the keyspace window. Leases last ~LEASE_SECS at
+// the node's measured rate, capped to a share of what is left so the tail
+// spreads over every node. The lease of a node that drops, or stays silent
+// for LEASE_TIMEOUT seconds while holding it, is handed out again, so the
+// checkpoint position is the lowest begin of any lease not yet done. Nodes
+// without a lease (still setting up, or waiting for the tail) never time
+// out. A verified password is broadcast and every node drops that target at
+// once.
+// No authentication or encryption: trusted networks only.
+//
+// One text line per message:
+//   node → coordinator   HELLO <version> | LEASE <units wanted> <at least>
+//                        DONE <lease> <attempts> | STAT <attempts> | FOUND <target> <password>
+//   coordinator → node   SPEC <lines> + checkpoint text | LEASE <id> <begin> <end>
+//                        WAIT | SOLVED <target> <password> | END | STOP | ERROR <why>
+// ══════════════════════════════════════════════════════════════════════════════
+constexpr int NET_PROTOCOL = 1;
+
+// Buffered line reader / writer over a socket
+struct NetLink {
+    int         fd = -1;
+    std::string buf;
+
+    // One recv into the buffer; false on EOF, error or an overlong line
+    bool fill() {
+        char    tmp[16384];
+        ssize_t r = ::recv(fd, tmp, sizeof(tmp), 0);
+        if (r < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) return true;
+        if (r <= 0) return false;
+        buf.append(tmp, static_cast<size_t>(r));
+        return buf.size() <= NET_MAX_LINE || buf.find('\n') != std::string::npos;
+    }
+    bool line(std::string& out) {
+        size_t nl = buf.find('\n');
+        if (nl == std::string::npos) return false;
+        out.assign(buf, 0, nl);
+        buf.erase(0, nl + 1);
+        return true;
+    }
+    bool read_line(std::string& out) {   // blocking (node handshake)
+        while (!line(out))
+            if (!fill()) return false;
+        return true;
+    }
+    bool write(const std::string& s) const {
+        for (size_t off = 0; off < s.size(); ) {
+            ssize_t w = ::send(fd, s.data() + off, s.size() - off, MSG_NOSIGNAL);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return false;
+            off += static_cast<size_t>(w);
+        }
+        return true;
+    }
+    bool send(const std::string& msg) const { return write(msg + "\n"); }
+    // Non-blocking socket: sends what it takes now and erases that from
+    // `out`; false only on a broken link
+    bool drain(std::string& out) const {
+        size_t off = 0;
+        while (off < out.size()) {
+            ssize_t w = ::send(fd, out.data() + off, out.size() - off, MSG_NOSIGNAL);
+            if (w < 0 && errno == EINTR) continue;
+            if (w < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (w <= 0) return false;
+            off += static_cast<size_t>(w);
+        }
+        out.erase(0, off);
+        return true;
+    }
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+        buf.clear();
+    }
+};
+
+// Listening (serve) or connected socket for "host:port" / "port"; -1 on
+// failure. Without a host: all interfaces to serve, localhost to connect.
+int net_open(const std::string& addr, bool serve) {
+    size_t      colon = addr.rfind(':');
+    std::string host  = colon == std::string::npos ? "" : addr.substr(0, colon);
+    std::string port  = colon == std::string::npos ? addr : addr.substr(colon + 1);
+    if (host.size() > 1 && host.front() == '[' && host.back() == ']') host = host.substr(1, host.size() - 2);
+
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = serve ? AI_PASSIVE : 0;
+    const char* node  = host.empty() ? (serve ? nullptr : "localhost") : host.c_str();
+    if (port.empty() || getaddrinfo(node, port.c_str(), &hints, &res) != 0) return -1;
+
+    int fd = -1;
+    for (addrinfo* a = res; a && fd < 0; a = a->ai_next) {
+        fd = ::socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd < 0) continue;
+        int  one = 1;
+        bool ok;
+        if (serve) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            ok = ::bind(fd, a->ai_addr, a->ai_addrlen) == 0 && ::listen(fd, 64) == 0;
+        } else {
+            ok = ::connect(fd, a->ai_addr, a->ai_addrlen) == 0;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        }
+        if (!ok) { ::close(fd); fd = -1; }
+    }
+    freeaddrinfo(res);
+    return fd;
+}
+
+std::string net_peer(int fd) {
+    sockaddr_storage sa;
+    socklen_t        len = sizeof(sa);
+    char             host[NI_MAXHOST], port[NI_MAXSERV];
+    if (getpeername(fd, reinterpret_cast<sockaddr*>(&sa), &len) != 0 ||
+        getnameinfo(reinterpret_cast<sockaddr*>(&sa), len, host, sizeof(host), port, sizeof(port),
+                    NI_NUMERICHOST | NI_NUMERICSERV) != 0)
+        return "?";
+    return std::string(host) + ":" + port;
+}
+
+// ── Coordinator ──────────────────────────────────────────────────────────────
+struct NetNode {
+    NetLink     link;
+    std::string name;            // peer address
+    bool        hello    = false;
+    uint64_t    lease    = 0;    // id of the lease held, 0 = none
+    uint64_t    begin    = 0, end = 0;
+    uint64_t    attempts = 0;    // last STAT
+    std::string out;             // replies the socket has not taken yet
+    std::chrono::steady_clock::time_point seen;
+};
+
+struct ServeResult {
+    uint64_t watermark = 0;      // everything below was tried
+    uint64_t nodes     = 0;      // joined during the run
+    uint64_t leases    = 0;      // completed
+    uint64_t requeued  = 0;      // handed out again after a node dropped
+};
+
+// Leases [start, ck.target_size) until every lease is done, every target is
+// solved or the run is interrupted. Saves `ck` every CHECKPOINT_SECS.
+ServeResult serve_attack(int listen_fd, Checkpoint ck, const std::string& ckpt_path, uint64_t start,
+                         CrackTarget* targets, size_t target_count,
+                         std::chrono::steady_clock::time_point start_time) {
+    using clock = std::chrono::steady_clock;
+    ServeResult res;
+    const uint64_t size = ck.target_size;
+    uint64_t frontier = start, next_id = 1, gone = 0;   // gone: attempts of nodes that left
+    int      live     = 0;
+
+    std::unique_ptr<NetNode[]>                nodes(new NetNode[NET_MAX_NODES]);
+    std::array<std::array<uint64_t, 2>, NET_MAX_NODES> requeued;   // ≤ one per node slot
+    size_t                                    requeued_n = 0;
+
+    auto watermark = [&] {
+        uint64_t w = frontier;
+        for (int i = 0; i < NET_MAX_NODES; ++i)
+            if (nodes[i].lease) w = std::min(w, nodes[i].begin);
+        for (size_t i = 0; i < requeued_n; ++i) w = std::min(w, requeued[i][0]);
+        return w;
+    };
+    // Node sockets are non-blocking: replies queue in n.out and go out as
+    // the node reads, so one stalled node cannot hold up the loop. False
+    // once the link broke or the node left NET_MAX_LINE unread.
+    auto post = [&](NetNode& n, const std::string& msg) {
+        n.out += msg;
+        n.out += '\n';
+        return n.link.drain(n.out) && n.out.size() <= NET_MAX_LINE;
+    };
+    auto drop = [&](NetNode& n, const char* why) {
+        bool had = n.lease != 0;
+        if (had) {
+            requeued[requeued_n++] = {n.begin, n.end};
+            ++res.requeued;
+        }
+        gone += n.attempts;
+        std::cout << "\33[2K\r\033[1;33m[!] Node " << n.name << " " << why
+                  << (had ? " — its lease goes to the next node" : "") << "\033[0m\n";
+        n.link.close();
+        n = NetNode();
+        --live;
+    };
+    auto broadcast = [&](const std::string& msg) {
+        for (int i = 0; i < NET_MAX_NODES; ++i)
+            if (nodes[i].link.fd >= 0 && nodes[i].hello && !post(nodes[i], msg))
+                drop(nodes[i], "stopped reading");
+    };
+
+    // false: protocol error, drop the node
+    auto handle = [&](NetNode& n, const std::string& msg) {
+        std::istringstream in(msg);
+        std::string        cmd;
+        in >> cmd;
+        if (cmd == "HELLO") {
+            int version = 0;
+            in >> version;
+            if (version != NET_PROTOCOL) {
+                post(n, "ERROR protocol " + std::to_string(NET_PROTOCOL) + " required");
+                return false;
+            }
+            Checkpoint spec = ck;
+            spec.position   = 0;
+            spec.attempts   = 0;
+            spec.solved     = solved_list(targets, target_count);
+            std::string text = checkpoint_text(spec);
+            n.hello = true;
+            text.pop_back();   // post() ends the last row
+            return post(n, "SPEC " + std::to_string(std::count(text.begin(), text.end(), '\n') + 1) +
+                           "\n" + text);
+        }
+        if (!n.hello) return false;
+        if (cmd == "LEASE") {
+            uint64_t want = 1, least = 1;
+            in >> want >> least;
+            if (n.lease) {   // abandoned without DONE
+                requeued[requeued_n++] = {n.begin, n.end};
+                n.lease = 0;
+            }
+            if (requeued_n) {
+                --requeued_n;
+                n.begin = requeued[requeued_n][0];
+                n.end   = requeued[requeued_n][1];
+            } else if (frontier < size) {
+                // Guided: at most half of an even split of the rest
+                uint64_t share = (size - frontier) / (2 * static_cast<uint64_t>(std::max(live, 1)));
+                uint64_t units = std::max<uint64_t>({std::min(want, share), least, 1});
+                n.begin  = frontier;
+                n.end    = frontier + std::min(units, size - frontier);
+                frontier = n.end;
+            } else {
+                return post(n, "WAIT");   // the tail is still out with other nodes
+            }
+            n.lease = next_id++;
+            return post(n, "LEASE " + std::to_string(n.lease) + " " + std::to_string(n.begin) +
+                           " " + std::to_string(n.end));
+        }
+        if (cmd == "DONE") {
+            uint64_t id = 0;
+            in >> id >> n.attempts;
+            if (id && id == n.lease) {
+                n.lease = 0;
+                ++res.leases;
+            }
+        } else if (cmd == "STAT") {
+            in >> n.attempts;
+        } else if (cmd == "FOUND") {
+            size_t      t = target_count;
+            std::string pwd;
+            in >> t;
+            in.get();   // the one separator; the password may hold spaces
+            std::getline(in, pwd);
+            if (t >= target_count) return true;
+            CrackTarget& tg = targets[t];
+            if (!tg.solved.load()) {
+                if (!confirm_password(tg, pwd)) {
+                    std::cout << "\33[2K\r\033[1;33m[!] Node " << n.name
+                              << " reported a password that does not verify\033[0m\n";
+                    return true;
+                }
+                if (record_solve(tg, pwd.data(), pwd.size())) {
+                    potfile_add(tg);
+                    if (target_count > 1)
+                        std::cout << "\33[2K\r\033[1;32m[+] " << tg.path << ": " << tg.password
+                                  << "\033[0m (node " << n.name << ", " << targets_left.load()
+                                  << " left)\n";
+                }
+            }
+            broadcast("SOLVED " + std::to_string(t) + " " + tg.password);
+        }
+        return true;
+    };
 
-    bool encrypted = (st.valid & ZIP_STAT_ENCRYPTION_METHOD) &&
-                     (st.encryption_method != ZIP_EM_NONE);
-    if (encrypted) enc_method = st.encryption_method;
-    zip_close(arc);
-    return encrypted;
-}
+    std::unique_ptr<pollfd[]>          fds(new pollfd[NET_MAX_NODES + 1]);
+    std::array<int, NET_MAX_NODES + 1> slot{};
+    auto   last_ckpt   = clock::now();
+    double last_t      = 0, rate = 0;
+    uint64_t last_n    = attempts_total(0);
+    bool   interrupted = false;
+    while (targets_left.load() && !(frontier >= size && watermark() >= size)) {
+        if (stop_requested.load()) { interrupted = true; break; }
 
-bool test_single_password(const std::string& zip_file, const std::string& pwd) {
-    int err;
-    zip_t* arc = zip_open(zip_file.c_str(), ZIP_RDONLY, &err);
-    if (!arc) return false;
+        int nf = 0;
+        fds[nf++] = {listen_fd, POLLIN, 0};
+        for (int i = 0; i < NET_MAX_NODES; ++i)
+            if (nodes[i].link.fd >= 0) {
+                slot[nf]  = i;
+                fds[nf++] = {nodes[i].link.fd,
+                             static_cast<short>(nodes[i].out.empty() ? POLLIN : POLLIN | POLLOUT), 0};
+            }
+        int r = ::poll(fds.get(), static_cast<nfds_t>(nf), STATS_TICK_MS);
+        if (r < 0 && errno != EINTR) {
+            std::cout << "\33[2K\r\033[1;31m[!] ERROR: poll failed on the coordinator socket\033[0m\n";
+            interrupted = true;
+            break;
+        }
+        auto now = clock::now();
+        for (int k = 1; r > 0 && k < nf; ++k) {
+            NetNode& n = nodes[slot[k]];
+            if (!fds[k].revents || n.link.fd != fds[k].fd) continue;
+            if ((fds[k].revents & POLLOUT) && !n.link.drain(n.out)) { drop(n, "disconnected"); continue; }
+            if (!(fds[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            if (!n.link.fill()) { drop(n, "disconnected"); continue; }
+            n.seen = now;
+            std::string msg;
+            bool        ok = true;
+            while (ok && n.link.fd >= 0 && n.link.line(msg)) ok = handle(n, msg);
+            if (!ok) drop(n, n.out.size() > NET_MAX_LINE ? "stopped reading" : "broke the protocol");
+        }
+        if (r > 0 && (fds[0].revents & POLLIN)) {
+            int c = ::accept(listen_fd, nullptr, nullptr);
+            int i = 0;
+            while (c >= 0 && i < NET_MAX_NODES && nodes[i].link.fd >= 0) ++i;
+            if (c >= 0 && i == NET_MAX_NODES) {
+                NetLink full{c, ""};
+                full.send("ERROR coordinator full");
+                full.close();
+            } else if (c >= 0) {
+                int one = 1;
+                setsockopt(c, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                fcntl(c, F_SETFL, fcntl(c, F_GETFL) | O_NONBLOCK);
+                nodes[i].link.fd = c;
+                nodes[i].name    = net_peer(c);
+                nodes[i].seen    = now;
+                ++live;
+                ++res.nodes;
+                std::cout << "\33[2K\r\033[1;32m[+] Node " << nodes[i].name << " joined ("
+                          << live << " connected)\033[0m\n";
+            }
+        }
+        for (int i = 0; i < NET_MAX_NODES; ++i)
+            if (nodes[i].link.fd >= 0 && nodes[i].lease &&
+                now - nodes[i].seen > std::chrono::seconds(LEASE_TIMEOUT))
+                drop(nodes[i], "went silent");
 
-    zip_file_t* zf = zip_fopen_index_encrypted(arc, 0, 0, pwd.c_str());
-    if (!zf) { zip_close(arc); return false; }
+        // Progress: the nodes' own counts, as the local reporter draws them
+        attempts_remote = gone;
+        for (int i = 0; i < NET_MAX_NODES; ++i) attempts_remote += nodes[i].attempts;
+        double t = std::chrono::duration<double>(now - start_time).count();
+        if (t - last_t >= STATS_TICK_MS / 1000.0) {
+            uint64_t cur  = attempts_total(0);
+            size_t   tot  = total_passwords.load(std::memory_order_relaxed);
+            double   inst = (cur - last_n) / (t - last_t);
+            rate = (last_t == 0) ? inst : 0.3 * inst + 0.7 * rate;
+            std::cout << "[-] ";
+            if (tot > 0)
+                std::cout << std::fixed << std::setprecision(1) << (cur * 100.0) / tot << "% | "
+                          << format_number(cur) << "/" << format_number(tot);
+            else
+                std::cout << "Attempts: " << format_number(cur);
+            std::cout << " | " << std::setprecision(0) << rate << " pwd/s";
+            if (tot > cur && rate > 0) std::cout << " | ETA: " << format_time((tot - cur) / rate);
+            std::cout << " | " << live << " node" << (live == 1 ? "" : "s") << "    \r" << std::flush;
+            last_n = cur;
+            last_t = t;
+        }
+        if (!ckpt_path.empty() && now - last_ckpt >= std::chrono::seconds(CHECKPOINT_SECS)) {
+            last_ckpt   = now;
+            ck.position = watermark();
+            ck.attempts = attempts_total(0);
+            if (ck.batch) ck.solved = solved_list(targets, target_count);
+            save_checkpoint(ckpt_path, ck);
+        }
+    }
 
-    char buf[8192];
-    zip_int64_t n = 0;
-    while ((n = zip_fread(zf, buf, sizeof(buf))) > 0) {}
-    bool ok = (n == 0);   // 0 = EOF, negative = CRC/decrypt error
-    zip_fclose(zf);
-    zip_close(arc);
-    return ok;
+    // END: keyspace done or every target solved; STOP: interrupted. Nodes
+    // whose socket was full get up to a second to take it before the close.
+    broadcast(interrupted ? "STOP" : "END");
+    for (auto until = clock::now() + std::chrono::seconds(1); clock::now() < until; ) {
+        int nf = 0;
+        for (int i = 0; i < NET_MAX_NODES; ++i)
+            if (nodes[i].link.fd >= 0 && !nodes[i].out.empty()) {
+                slot[nf]  = i;
+                fds[nf++] = {nodes[i].link.fd, POLLOUT, 0};
+            }
+        if (nf == 0 || ::poll(fds.get(), static_cast<nfds_t>(nf), 100) < 0) break;
+        for (int k = 0; k < nf; ++k)
+            if (fds[k].revents && !nodes[slot[k]].link.drain(nodes[slot[k]].out))
+                nodes[slot[k]].out.clear();   // gone; nothing more to send
+    }
+    attempts_remote = gone;
+    for (int i = 0; i < NET_MAX_NODES; ++i) {
+        attempts_remote += nodes[i].attempts;
+        nodes[i].link.close();
+    }
+    res.watermark = watermark();
+    return res;
 }
 
-// ══════════════════════════════════════════════════════════════════════════════
-// Worker thread  —  pulls passwords from the shared queue (dynamic balancing)
-// ══════════════════════════════════════════════════════════════════════════════
-void worker(int id, BoundedQueue<std::string>& queue,
-            const std::string& zip_file,
-            std::chrono::steady_clock::time_point start_time) {
-
-    int err;
-    zip_t* arc = zip_open(zip_file.c_str(), ZIP_RDONLY, &err);
-    if (!arc) {
-        std::lock_guard<std::mutex> lk(progress_mutex);
-        std::cerr << "\n[!] Worker " << id
-                  << " failed to open archive (error: " << err << ")\n";
-        return;
+// ── Node ─────────────────────────────────────────────────────────────────────
+// Connects and receives the attack spec; false with a reason on failure
+bool node_join(NetLink& link, const std::string& addr, Checkpoint& spec, std::string& why) {
+    link.fd = net_open(addr, false);
+    if (link.fd < 0) { why = "cannot connect to " + addr; return false; }
+    std::string line;
+    if (!link.send("HELLO " + std::to_string(NET_PROTOCOL)) || !link.read_line(line)) {
+        why = "coordinator closed the connection";
+        return false;
     }
+    if (line.compare(0, 5, "SPEC ") != 0) {
+        why = line.compare(0, 6, "ERROR ") == 0 ? line.substr(6) : "unexpected reply: " + line;
+        return false;
+    }
+    std::string text, row;
+    for (size_t n = std::strtoull(line.c_str() + 5, nullptr, 10); n > 0; --n) {
+        if (!link.read_line(row)) { why = "spec cut short"; return false; }
+        text += row + "\n";
+    }
+    std::istringstream in(text);
+    if (!parse_checkpoint(in, spec)) { why = "unreadable attack spec"; return false; }
+    return true;
+}
 
-    std::string pwd;
-    while (!password_found.load(std::memory_order_acquire) && queue.pop(pwd)) {
+// Sends "STAT 0" every few seconds while the node builds its attack
+// (counting wordlist lines, loading Markov stats, self-tests), which can
+// outlast LEASE_TIMEOUT on a cold disk. Stopped before node_attack.
+class NodeKeepalive {
+    std::mutex              m_;
+    std::condition_variable cv_;
+    bool                    done_ = false;
+    std::thread             thread_;
 
-        zip_file_t* zf = zip_fopen_index_encrypted(arc, 0, 0, pwd.c_str());
-        size_t current = attempts_made.fetch_add(1, std::memory_order_relaxed) + 1;
+public:
+    explicit NodeKeepalive(const NetLink& link) {
+        thread_ = std::thread([this, &link] {
+            std::unique_lock<std::mutex> lk(m_);
+            while (!cv_.wait_for(lk, std::chrono::seconds(LEASE_TIMEOUT / 3), [this] { return done_; }))
+                if (!link.send("STAT 0")) return;
+        });
+    }
+    ~NodeKeepalive() {
+        {
+            std::lock_guard<std::mutex> lk(m_);
+            done_ = true;
+        }
+        cv_.notify_all();
+        thread_.join();
+    }
+    NodeKeepalive(const NodeKeepalive&) = delete;
+    NodeKeepalive& operator=(const NodeKeepalive&) = delete;
+};
 
-        if (zf) {
-            char buf[8192];
-            zip_int64_t n = 0;
-            while ((n = zip_fread(zf, buf, sizeof(buf))) > 0) {}
+// Runs leases until the coordinator ends the run, every target falls or the
+// node is stopped. `run` starts the local pool on the current window and
+// returns once it is exhausted (or found / stopped). A listener thread takes
+// SOLVED / STOP / END as they arrive and sends FOUND and STAT each tick.
+// Returns the number of leases completed.
+template <class Run>
+uint64_t node_attack(NetLink& link, MaskKeyspace* mask, MappedWordlist* words, int threads,
+                     CrackTarget* targets, size_t target_count, Run run) {
+    std::mutex              send_m, m;
+    std::condition_variable cv;
+    std::string             reply;          // LEASE / WAIT for the lease loop
+    bool                    ended = false;  // END, STOP or link lost
+    std::atomic<bool>       quit(false);
+    std::unique_ptr<bool[]> reported(new bool[target_count]);   // listener only
+    for (size_t t = 0; t < target_count; ++t) reported[t] = targets[t].solved.load();
 
-            bool success = (n == 0);  // n == 0: EOF clean; n < 0: CRC error
-            zip_fclose(zf);
+    auto send = [&](const std::string& msg) {
+        std::lock_guard<std::mutex> lk(send_m);
+        return link.send(msg);
+    };
+    auto finish = [&] {
+        std::lock_guard<std::mutex> lk(m);
+        ended = true;
+        cv.notify_all();
+    };
 
-            if (success) {
-                std::lock_guard<std::mutex> lk(password_mutex);
-                if (!password_found.load(std::memory_order_acquire)) {
-                    password_found.store(true, std::memory_order_release);
-                    correct_password = pwd;
-                    queue.set_done();   // wake producer + other workers
+    std::thread listener([&] {
+        pollfd      p{link.fd, POLLIN, 0};
+        std::string msg;
+        for (;;) {
+            bool last = quit.load();
+            if (::poll(&p, 1, last ? 0 : STATS_TICK_MS) > 0 && !link.fill()) {
+                bool expected;
+                {
+                    std::lock_guard<std::mutex> lk(m);
+                    expected = ended || last;   // closed after END / STOP, or we are leaving
                 }
-                break;
+                if (!expected) {
+                    std::cout << "\33[2K\r\033[1;33m[!] Lost the coordinator — stopping\033[0m\n";
+                    stop_requested.store(true);
+                }
+                finish();
+                return;
             }
-        }
-
-        // ── Progress reporting every 500 attempts (per worker) ────────────
-        if (current % 500 == 0) {
-            auto now = std::chrono::steady_clock::now();
-            auto ms  = std::chrono::duration_cast<
-                           std::chrono::milliseconds>(now - start_time).count();
-            if (ms > 0) {
-                double sec  = ms / 1000.0;
-                double rate = current / sec;
-                size_t tot  = total_passwords.load(std::memory_order_relaxed);
-
-                std::lock_guard<std::mutex> lk(progress_mutex);
-                if (tot > 0) {
-                    double pct = (current * 100.0) / tot;
-                    double eta = (rate > 0) ? ((tot - current) / rate) : 0;
-                    std::cout << "[-] " << std::fixed << std::setprecision(1)
-                              << pct << "% | "
-                              << format_number(current) << "/" << format_number(tot)
-                              << " | " << std::setprecision(0) << rate
-                              << " pwd/s | ETA: " << format_time(eta)
-                              << "    \r" << std::flush;
+            while (link.line(msg)) {
+                std::istringstream in(msg);
+                std::string        cmd;
+                in >> cmd;
+                if (cmd == "SOLVED") {
+                    size_t      t = target_count;
+                    std::string pwd;
+                    in >> t;
+                    in.get();
+                    std::getline(in, pwd);
+                    if (t >= target_count) continue;
+                    record_solve(targets[t], pwd.data(), pwd.size());
+                    reported[t] = true;
+                } else if (cmd == "STOP") {
+                    stop_requested.store(true);
+                    finish();
+                } else if (cmd == "END") {
+                    finish();
                 } else {
-                    std::cout << "[-] Attempts: " << format_number(current)
-                              << " | " << std::setprecision(0) << rate
-                              << " pwd/s    \r" << std::flush;
+                    if (cmd == "ERROR")
+                        std::cout << "\33[2K\r\033[1;31m[!] Coordinator: " << msg.substr(6) << "\033[0m\n";
+                    std::lock_guard<std::mutex> lk(m);
+                    reply = msg;
+                    cv.notify_all();
                 }
             }
+            // Passwords go out as soon as they are found, the count every tick
+            for (size_t t = 0; t < target_count; ++t) {
+                if (reported[t] || !targets[t].solved.load(std::memory_order_acquire)) continue;
+                reported[t] = true;
+                send("FOUND " + std::to_string(t) + " " + targets[t].password);
+            }
+            send("STAT " + std::to_string(attempts_total(threads)));
+            if (last) return;
         }
-    }
+    });
 
-    zip_close(arc);
+    // First lease: one slab per worker; then LEASE_SECS at the measured rate
+    const uint64_t first = static_cast<uint64_t>(threads) * POOL_SLAB * (mask ? mask->chunk() : words->chunk());
+    uint64_t       want  = first, leases = 0;
+    while (!password_found.load() && !stop_requested.load()) {
+        std::string r;
+        if (!send("LEASE " + std::to_string(want) + " " + std::to_string(first))) break;
+        {
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait(lk, [&] { return ended || !reply.empty(); });
+            if (ended) break;
+            r.swap(reply);
+        }
+        std::istringstream in(r);
+        std::string        cmd;
+        uint64_t           id = 0, b = 0, e = 0;
+        if (!(in >> cmd >> id >> b >> e) || cmd != "LEASE") {   // WAIT: others hold the tail
+            std::unique_lock<std::mutex> lk(m);
+            cv.wait_for(lk, std::chrono::seconds(1), [&] { return ended; });
+            if (ended) break;
+            continue;
+        }
+        if (mask) mask->window(b, e);
+        else      words->window(b, e);
+        auto t0 = std::chrono::steady_clock::now();
+        run();
+        if (password_found.load() || stop_requested.load()) break;
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        send("DONE " + std::to_string(id) + " " + std::to_string(attempts_total(threads)));
+        ++leases;
+        want = std::max(first, static_cast<uint64_t>((e - b) / std::max(secs, 0.001) * LEASE_SECS));
+    }
+    quit.store(true);
+    listener.join();
+    link.close();
+    return leases;
 }
 
 // ══════════════════════════════════════════════════════════════════════════════
-// Wordlist producer  —  streams passwords from file into the queue
-// Author: Zakaria | Logic: sequential stream with atomic stop-flag
+// Benchmark  —  synthetic archives, one component at a time, thread sweep
+// Encrypted entries with known passwords are built in memory (ZipCrypto over
+// deflated text, WinZip AES-128/256 with a real PVV and HMAC) and fed to the
+// same verifiers a real attack uses. Each component runs for BENCH_RUN_MS per
+// repetition: one warm-up, then BENCH_REPS timed runs reported as mean ±
+// standard deviation, at 1, 2, 4, ... threads up to the core count.
 // ══════════════════════════════════════════════════════════════════════════════
-void wordlist_producer(const std::string& path, BoundedQueue<std::string>& queue) {
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        std::cerr << "\033[1;31m[!] ERROR: Cannot open wordlist file\033[0m\n";
-        queue.set_done();
-        return;
+constexpr int    BENCH_RUN_MS = 300;    // per timed repetition
+constexpr int    BENCH_REPS   = 5;      // after one warm-up run
+constexpr size_t BENCH_WORDS  = 1 << 20;
+
+struct BenchResult {
+    double mean = 0, sd = 0, lo = 0, hi = 0;
+};
+
+// body(thread, stop) runs until `stop` (or its input ends) and returns the
+// candidates it handled; result is candidates per second of wall time
+template<typename Body>
+double bench_run(int threads, Body body) {
+    std::atomic<bool>                    stop(false);
+    std::atomic<int>                     finished(0);
+    std::array<uint64_t, MAX_THREADS>    counts{};
+    std::array<std::thread, MAX_THREADS> pool;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < threads; ++i)
+        pool[i] = std::thread([&, i] { pin_to_cpu(i); counts[i] = body(i, stop); ++finished; });
+    auto deadline = t0 + std::chrono::milliseconds(BENCH_RUN_MS);
+    while (std::chrono::steady_clock::now() < deadline && finished.load() < threads)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    stop = true;
+    for (int i = 0; i < threads; ++i) pool[i].join();
+    double   sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    uint64_t sum = 0;
+    for (int i = 0; i < threads; ++i) sum += counts[i];
+    return sum / sec;
+}
+
+template<typename Run>
+BenchResult bench_repeat(Run run) {
+    std::array<double, BENCH_REPS> x{};
+    run();   // warm-up: page faults, frequency ramp, first-touch allocations
+    BenchResult r;
+    r.lo = std::numeric_limits<double>::max();
+    for (int i = 0; i < BENCH_REPS; ++i) {
+        x[i]  = run();
+        r.mean += x[i] / BENCH_REPS;
+        r.lo   = std::min(r.lo, x[i]);
+        r.hi   = std::max(r.hi, x[i]);
     }
+    for (int i = 0; i < BENCH_REPS; ++i) r.sd += (x[i] - r.mean) * (x[i] - r.mean);
+    r.sd = std::sqrt(r.sd / (BENCH_REPS - 1));
+    return r;
+}
 
-    std::string line;
-    while (std::getline(file, line) &&
-           !password_found.load(std::memory_order_acquire)) {
-        // strip trailing CR / LF / space
-        while (!line.empty() &&
-               (line.back() == '\r' || line.back() == '\n' || line.back() == ' '))
-            line.pop_back();
+// ── Synthetic entries ────────────────────────────────────────────────────────
+// ZipCrypto over raw-deflated text, no data descriptor (check byte = CRC MSB)
+bool synth_zipcrypto(const std::string& pwd, std::mt19937& rng, NativeVerifier& nv) {
+    std::string plain;
+    while (plain.size() < 16384) plain += "entry " + std::to_string(rng() % 100000) + " lorem ipsum\n";
 
-        if (!line.empty()) {
-            total_passwords.fetch_add(1, std::memory_order_relaxed);
-            if (!queue.push(std::move(line))) break;   // queue closed
-        }
+    z_stream zs{};
+    if (deflateInit2(&zs, 6, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+    std::string comp(deflateBound(&zs, plain.size()), '\0');
+    zs.next_in   = reinterpret_cast<Bytef*>(&plain[0]);
+    zs.avail_in  = static_cast<uInt>(plain.size());
+    zs.next_out  = reinterpret_cast<Bytef*>(&comp[0]);
+    zs.avail_out = static_cast<uInt>(comp.size());
+    bool ok = deflate(&zs, Z_FINISH) == Z_STREAM_END;
+    comp.resize(zs.total_out);
+    deflateEnd(&zs);
+    if (!ok) return false;
+
+    ZipEntryInfo& e = nv.entry;
+    e.crc         = static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(plain.data()),
+                                                static_cast<uInt>(plain.size())));
+    e.flags       = 0x0001;
+    e.method      = 8;
+    e.uncomp_size = plain.size();
+    e.comp_size   = 12 + comp.size();
+
+    std::string   clear(12, '\0');
+    for (int i = 0; i < 11; ++i) clear[i] = static_cast<char>(rng());
+    clear[11] = static_cast<char>(e.crc >> 24);
+    clear += comp;
+    ZipCryptoKeys keys;
+    for (char c : pwd) keys.update(static_cast<uint8_t>(c));
+    nv.payload.resize(clear.size());
+    for (size_t i = 0; i < clear.size(); ++i) {
+        uint8_t p = static_cast<uint8_t>(clear[i]);
+        nv.payload[i] = static_cast<char>(p ^ keys.stream_byte());
+        keys.update(p);
     }
-    queue.set_done();
+    nv.method    = ZIP_EM_TRAD_PKWARE;
+    nv.zc_kernel = select_zipcrypto_kernel();
+    std::memcpy(nv.zc.enc_header.data(), nv.payload.data(), 12);
+    nv.zc.check     = static_cast<uint8_t>(e.crc >> 24);
+    nv.libzip_final = false;
+    return true;
 }
 
-// ══════════════════════════════════════════════════════════════════════════════
-// Mask producer  —  generates passwords with iterative BFS and streams them
-// (no recursion, no vector — uses a local std::queue for BFS state only)
-// ══════════════════════════════════════════════════════════════════════════════
-void mask_producer(const std::string& mask, BoundedQueue<std::string>& queue) {
-    struct State { std::string cur; size_t pos; };
+// WinZip AES: salt | PVV | ciphertext | HMAC-SHA1/80. The ciphertext is random
+// bytes: the verifier only authenticates it, it never decrypts.
+void synth_aes(const std::string& pwd, int strength, std::mt19937& rng, NativeVerifier& nv) {
+    AesTarget& t = nv.aes;
+    t.key_len  = 8 + 8 * strength;
+    t.salt_len = t.key_len / 2;
+    for (int i = 0; i < t.salt_len; ++i) t.salt[i] = static_cast<unsigned char>(rng());
+    unsigned char dk[80];
+    aes_derive(t, pwd.data(), pwd.size(), dk);
+    t.pvv[0] = dk[2 * t.key_len];
+    t.pvv[1] = dk[2 * t.key_len + 1];
+
+    std::string cipher(4096, '\0');
+    for (char& c : cipher) c = static_cast<char>(rng());
+    uint32_t ipad[5], opad[5];
+    hmac_sha1_pads(reinterpret_cast<const char*>(dk + t.key_len), t.key_len, ipad, opad);
+    Sha1 inner, outer;
+    std::memcpy(inner.h, ipad, 20);
+    inner.total = 64;
+    inner.update(cipher.data(), cipher.size());
+    unsigned char mac[20];
+    inner.final(mac);
+    std::memcpy(outer.h, opad, 20);
+    outer.total = 64;
+    outer.update(mac, 20);
+    outer.final(mac);
+    std::memcpy(t.auth, mac, 10);
+    t.cipher_len = cipher.size();
 
-    // Local BFS queue — only holds intermediate partial strings, not all passwords
-    std::queue<State> gen;
-    gen.push({"", 0});
+    nv.payload.assign(reinterpret_cast<const char*>(t.salt), t.salt_len);
+    nv.payload.append(reinterpret_cast<const char*>(t.pvv), 2);
+    nv.payload += cipher;
+    nv.payload.append(reinterpret_cast<const char*>(t.auth), 10);
+    nv.entry.comp_size    = nv.payload.size();
+    nv.entry.aes_strength = static_cast<uint8_t>(strength);
+    nv.method     = strength == 1 ? ZIP_EM_AES_128 : ZIP_EM_AES_256;
+    nv.aes_kernel = select_aes_kernel();
+    nv.libzip_final = false;
+}
+
+// Same path as a worker: batched check, later stages for survivors
+bool bench_accepts(const NativeVerifier& nv, const std::string& pwd, VerifyScratch& vs) {
+    const char* p = pwd.c_str();
+    uint32_t    l = static_cast<uint32_t>(pwd.size());
+    return nv.check(&p, &l, 1) == 1 && nv.verify(p, l, vs) == STAGE_COUNT;
+}
 
-    while (!gen.empty() && !password_found.load(std::memory_order_acquire)) {
-        State st = std::move(gen.front());
-        gen.pop();
+// `max_threads` = --threads, 0 for one per usable CPU
+int run_benchmark(int max_threads) {
+    topology  = detect_topology();
+    int cores = max_threads > 0 ? std::min(max_threads, MAX_THREADS) : topology.count;
+    std::array<int, MAX_THREADS> sweep{};
+    int steps = 0;
+    for (int t = 1; t < cores; t *= 2) sweep[steps++] = t;
+    sweep[steps++] = cores;
 
-        // Completed password
-        if (st.pos >= mask.size()) {
-            total_passwords.fetch_add(1, std::memory_order_relaxed);
-            if (!queue.push(std::move(st.cur))) break;   // queue closed
-            continue;
+    std::ofstream json_file;
+    if (!stats_json_path.empty() && stats_json_path != "-") json_file.open(stats_json_path, std::ios::app);
+    std::ostream* json = stats_json_path == "-" ? &std::cout : json_file.is_open() ? &json_file : nullptr;
+
+    auto report = [&](const char* key, const std::string& title, auto run) {
+        std::cout << "\n\033[1;36m[*] " << title << "\033[0m\n"
+                  << "    threads        cand/s     ±sd        min – max\n";
+        for (int i = 0; i < steps; ++i) {
+            BenchResult r = bench_repeat([&] { return run(sweep[i]); });
+            std::cout << "    " << std::setw(7) << sweep[i] << " " << std::setw(13)
+                      << format_number(static_cast<size_t>(r.mean)) << "  " << std::fixed
+                      << std::setprecision(1) << std::setw(5) << (r.mean > 0 ? 100 * r.sd / r.mean : 0)
+                      << "%   " << format_number(static_cast<size_t>(r.lo)) << " – "
+                      << format_number(static_cast<size_t>(r.hi)) << "\n" << std::flush;
+            if (json)
+                *json << std::fixed << std::setprecision(1) << "{\"bench\":\"" << key
+                      << "\",\"threads\":" << sweep[i] << ",\"mean\":" << r.mean << ",\"sd\":" << r.sd
+                      << ",\"min\":" << r.lo << ",\"max\":" << r.hi << ",\"run_ms\":" << BENCH_RUN_MS
+                      << ",\"reps\":" << BENCH_REPS << "}\n" << std::flush;
         }
+    };
 
-        if (mask[st.pos] == '?' && st.pos + 1 < mask.size()) {
-            const char* chars = nullptr;
-            size_t      len   = 0;
+    std::cout << "[*] Benchmark: " << BENCH_REPS << " × " << BENCH_RUN_MS
+              << " ms per point after a warm-up, up to " << cores << " threads\n";
 
-            switch (mask[st.pos + 1]) {
-                case 'd': chars = DIGITS;           len = 10;               break;
-                case 'l': chars = LOWERS;           len = 26;               break;
-                case 'u': chars = UPPERS;           len = 26;               break;
-                case 's': chars = SPECIALS;         len = strlen(SPECIALS); break;
-                case 'a': chars = ALPHANUM.c_str(); len = ALPHANUM.size();  break;
-                default:
-                    // '?' followed by unknown char → treat '?' as literal
-                    gen.push({st.cur + mask[st.pos], st.pos + 1});
-                    continue;
+    // ── Synthetic targets (fixed seed: identical work across versions) ───────
+    std::mt19937   rng(0x5A4B);
+    NativeVerifier zc, aes128, aes256;
+    const std::string pwd = "Bench#2024";
+    VerifyScratch  vs;
+    if (!synth_zipcrypto(pwd, rng, zc)) {
+        std::cout << "\033[1;31m[!] ERROR: Cannot build the synthetic ZipCrypto entry\033[0m\n";
+        return 1;
+    }
+    synth_aes(pwd, 1, rng, aes128);
+    synth_aes(pwd, 3, rng, aes256);
+    for (const NativeVerifier* nv : {&zc, &aes128, &aes256}) {
+        if (!bench_accepts(*nv, pwd, vs) || bench_accepts(*nv, pwd + "x", vs)) {
+            std::cout << "\033[1;31m[!] ERROR: " << nv->engine()
+                      << " verifier failed its self-test\033[0m\n";
+            return 1;
+        }
+    }
+    std::cout << "\033[1;32m[+] Synthetic archives verified (ZipCrypto/deflate, AES-128, AES-256)\033[0m\n";
+
+    // Candidate pool: BENCH_WORDS words of 6-12 characters as newline text
+    std::string text;
+    text.reserve(BENCH_WORDS * 10);
+    for (size_t i = 0; i < BENCH_WORDS; ++i) {
+        size_t len = 6 + rng() % 7;
+        for (size_t j = 0; j < len; ++j) text += ALPHANUM[rng() % ALPHANUM.size()];
+        text += '\n';
+    }
+
+    // ── Candidate generation ────────────────────────────────────────────────
+    // Full lane batches, as the workers fill them
+    auto mask_rate = [&](MaskKeyspace& m, bool generic, int threads) {
+        RangePool pool(threads);
+        m.fit_workers(threads);
+        m.start_at(0);
+        return bench_run(threads, [&](int id, const std::atomic<bool>& stop) {
+            uint64_t    n = 0, pos, end;
+            std::string cur;
+            std::array<uint32_t, MAX_MASK_LEN> digits{};
+            std::array<uint32_t, ZC_MAX_LANES> lens{};
+            std::unique_ptr<char[]> lanes(new char[ZC_MAX_LANES * MASK_LANE]);
+            while (!stop.load(std::memory_order_relaxed) && pool.next(id, m, pos, end)) {
+                m.seek(pos, cur, digits.data());
+                while (pos < end)
+                    n += m.emit(pos, end, cur, digits.data(), lanes.get(), lens.data(), ZC_MAX_LANES, generic);
             }
+            return n;
+        });
+    };
+    MaskKeyspace mask("?l?l?l?l?l?d?d?d?d");
+    report("mask", "Mask generation (?l?l?l?l?l?d?d?d?d, range pool + odometer)",
+           [&](int threads) { return mask_rate(mask, true, threads); });
+    MaskKeyspace digits10("?d?d?d?d?d?d?d?d?d?d");
+    report("mask-kernel", "Mask generation (?d x10, specialised kernel)",
+           [&](int threads) { return mask_rate(digits10, false, threads); });
 
-            for (size_t i = 0; i < len; ++i)
-                gen.push({st.cur + chars[i], st.pos + 2});
-        } else {
-            // Literal character
-            gen.push({st.cur + mask[st.pos], st.pos + 1});
-        }
+    // Mapped wordlist: a temporary file, unlinked once mapped
+    char tmpl[] = "/tmp/zc_bench_XXXXXX";
+    int  fd     = mkstemp(tmpl);
+    bool wrote  = fd >= 0 && ::write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+    if (fd >= 0) ::close(fd);
+    std::unique_ptr<MappedWordlist> words(wrote ? new MappedWordlist(tmpl) : nullptr);
+    if (fd >= 0) ::unlink(tmpl);
+    if (words && words->valid()) {
+        report("wordlist", "Wordlist parsing (memory-mapped, per-thread ranges)", [&](int threads) {
+            return bench_run(threads, [&](int id, const std::atomic<bool>& stop) {
+                uint64_t b = words->size() * id / threads, e = words->size() * (id + 1) / threads;
+                uint64_t n = 0;
+                MappedWordlist::Cursor c;
+                std::string_view       line;
+                words->seek(b, e, c);
+                while (!stop.load(std::memory_order_relaxed))
+                    for (int k = 0; k < 4096; ++k)
+                        if (words->next(c, line)) ++n;
+                        else words->seek(b, e, c);   // wrap around the thread's range
+                return n;
+            });
+        });
+    } else {
+        std::cout << "\033[1;33m[!] Skipping wordlist parsing: cannot write a temporary file\033[0m\n";
     }
 
-    queue.set_done();
+    // ── Queue transport: one producer filling blocks, N workers draining ────
+    report("transport", "Block transport (1 producer → N consumers)", [&](int threads) {
+        CandidateChannel  channel(BLOCK_POOL);
+        std::atomic<bool> halt(false);
+        std::thread producer([&] {
+            const char* p   = text.data();
+            const char* eof = p + text.size();
+            CandidateBlock* blk = channel.acquire();
+            while (blk && !halt.load(std::memory_order_relaxed)) {
+                const char* nl = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(eof - p)));
+                if (blk->add(p, static_cast<size_t>(nl - p))) {
+                    p = (nl + 1 < eof) ? nl + 1 : text.data();
+                    continue;
+                }
+                if (!channel.publish(blk)) break;
+                blk = channel.acquire();
+            }
+            channel.producer_done();
+        });
+        double rate = bench_run(threads, [&](int, const std::atomic<bool>& stop) {
+            uint64_t n = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                CandidateBlock* blk = channel.take();
+                if (!blk) break;
+                size_t      off = 0;
+                const char* w;
+                uint32_t    wl;
+                while (blk->next(off, w, wl)) ++n;
+                channel.release(blk);
+            }
+            return n;
+        });
+        halt = true;
+        channel.close();
+        producer.join();
+        return rate;
+    });
+
+    // ── Verifiers: every candidate through check(), survivors through verify()
+    auto verifier_bench = [&](const NativeVerifier& verifier) {
+        const NativeVerifier* nvp = &verifier;
+        return [&, nvp](int threads) {
+            const NativeVerifier& nv = *nvp;
+            return bench_run(threads, [&](int id, const std::atomic<bool>& stop) {
+                VerifyScratch                         scratch;
+                std::array<const char*, ZC_MAX_LANES> ptrs{};
+                std::array<uint32_t, ZC_MAX_LANES>    lens{};
+                const char* p   = text.data() + text.size() * id / threads;
+                const char* eof = text.data() + text.size();
+                p = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(eof - p))) + 1;
+                if (p >= eof) p = text.data();
+                uint64_t n = 0;
+                const int lanes = nv.lanes();
+                while (!stop.load(std::memory_order_relaxed)) {
+                    for (int j = 0; j < lanes; ++j) {
+                        const char* nl = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(eof - p)));
+                        ptrs[j] = p;
+                        lens[j] = static_cast<uint32_t>(nl - p);
+                        p = (nl + 1 < eof) ? nl + 1 : text.data();
+                    }
+                    uint32_t survivors = nv.check(ptrs.data(), lens.data(), lanes);
+                    for (int j = 0; survivors && j < lanes; ++j)
+                        if (survivors & (1u << j)) nv.verify(ptrs[j], lens[j], scratch);
+                    n += static_cast<uint64_t>(lanes);
+                }
+                return n;
+            });
+        };
+    };
+    report("zipcrypto", "ZipCrypto verifier (" + zc.engine() + ", " + std::to_string(zc.lanes())
+                        + " lanes, deflate probe + CRC32 for survivors)", verifier_bench(zc));
+    report("aes128", "AES-128 verifier (" + aes128.engine() + ", " + std::to_string(aes128.lanes())
+                     + " lanes, HMAC for survivors)", verifier_bench(aes128));
+    report("aes256", "AES-256 verifier (" + aes256.engine() + ", " + std::to_string(aes256.lanes())
+                     + " lanes, HMAC for survivors)", verifier_bench(aes256));
+
+    std::cout << "\n\033[1;32m[+] Benchmark complete\033[0m\n";
+    return 0;
 }
 
 // ══════════════════════════════════════════════════════════════════════════════
 // Main
 // ══════════════════════════════════════════════════════════════════════════════
-int main() {
+int main(int argc, char** argv) {
+    // ── Subcommands ──────────────────────────────────────────────────────────
+    if (argc > 1 && std::strcmp(argv[1], "compile-wordlist") == 0) {
+        if (argc != 4) {
+            std::cout << "Usage: " << argv[0] << " compile-wordlist <wordlist.txt> <out.zcw>\n";
+            return 1;
+        }
+        return compile_wordlist(argv[2], argv[3]);
+    }
+
+    // ── Command line ─────────────────────────────────────────────────────────
+    Checkpoint  resume_ck;
+    std::string resume_path;
+    bool        cross_check = true;
+    std::string batch_path;        // --batch: file listing the archives
+    std::string history_path = default_state_path(".zip_cracker.history");
+    potfile_path             = default_state_path(".zip_cracker.pot");
+    Checkpoint  mask_args;         // mask options from the command line
+    bool        increment   = false;
+    bool        benchmark   = false;
+    int         threads_arg = 0;   // --threads: 0 = one per usable CPU
+    std::string serve_addr;        // --serve: coordinate nodes instead of running workers
+    std::string connect_addr;      // --connect: run as a node of that coordinator
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg  = argv[i];
+            bool        more = i + 1 < argc;
+            if (arg == "--resume" && more) {
+                resume_path = argv[++i];
+            } else if (arg == "--batch" && more) {
+                batch_path = argv[++i];
+            } else if (arg == "--potfile" && more) {
+                potfile_path = argv[++i];
+            } else if (arg == "--no-potfile") {
+                potfile_path.clear();
+            } else if (arg == "--history" && more) {
+                history_path = argv[++i];
+            } else if (arg == "--no-history") {
+                history_path.clear();
+            } else if (arg == "--stats-json" && more) {
+                stats_json_path = argv[++i];
+            } else if (arg == "--stats-interval" && more) {
+                stats_interval = std::stod(argv[++i]);
+            } else if (arg == "--threads" && more) {
+                threads_arg = std::stoi(argv[++i]);
+            } else if (arg == "--no-pin") {
+                pin_workers = false;
+            } else if (arg == "--serve" && more) {
+                serve_addr = argv[++i];
+            } else if (arg == "--connect" && more) {
+                connect_addr = argv[++i];
+            } else if (arg == "--benchmark") {
+                benchmark = true;
+            } else if (arg == "--no-cross-check") {
+                cross_check = false;
+            } else if (arg.size() == 2 && arg[0] == '-' && arg[1] >= '1' && arg[1] <= '4' && more) {
+                mask_args.charsets[arg[1] - '1'] = argv[++i];
+            } else if (arg == "--increment") {
+                increment = true;
+            } else if (arg == "--increment-min" && more) {
+                increment = true;
+                mask_args.inc_min = std::stoull(argv[++i]);
+            } else if (arg == "--increment-max" && more) {
+                increment = true;
+                mask_args.inc_max = std::stoull(argv[++i]);
+            } else if (arg == "--markov" && more) {
+                mask_args.markov = argv[++i];
+            } else if (arg == "--markov-threshold" && more) {
+                mask_args.markov_threshold = std::stod(argv[++i]);
+            } else {
+                throw std::invalid_argument(arg);
+            }
+        }
+    } catch (const std::exception&) {
+        std::cout << "Usage: " << argv[0] << " [--resume <checkpoint>] [--batch <archive list>] [--no-cross-check]\n"
+                  << "       [--potfile <file> | --no-potfile] [--history <file> | --no-history]\n"
+                  << "       [--stats-json <file|->] [--stats-interval <seconds>]\n"
+                  << "       [--threads N] [--no-pin] [--serve [host:]port]\n"
+                  << "       " << argv[0] << " --connect host:port [--threads N] [--no-pin]\n"
+                  << "       " << argv[0] << " --benchmark [--stats-json <file|->]\n"
+                  << "       [-1..-4 <charset>] [--increment] [--increment-min N] [--increment-max N]\n"
+                  << "       [--markov <wordlist>] [--markov-threshold <p|N>]\n"
+                  << "       " << argv[0] << " compile-wordlist <wordlist.txt> <out.zcw>\n";
+        return 1;
+    }
+    if (increment && mask_args.inc_min == 0) mask_args.inc_min = 1;
+
+    const bool serving = !serve_addr.empty();
+    const bool node    = !connect_addr.empty();
+    if (node && (serving || !resume_path.empty() || !batch_path.empty())) {
+        std::cout << "\033[1;31m[!] ERROR: --connect takes the attack from the coordinator "
+                     "(no --serve, --resume or --batch)\033[0m\n";
+        return 1;
+    }
+
+    bool    resuming = !resume_path.empty();
+    NetLink node_link;
+    std::unique_ptr<NodeKeepalive> keepalive;   // node: heartbeat until the leases start
+    if (node) {
+        std::string why;
+        if (!node_join(node_link, connect_addr, resume_ck, why)) {
+            std::cout << "\033[1;31m[!] ERROR: Cannot join coordinator: " << why << "\033[0m\n";
+            return 1;
+        }
+        keepalive.reset(new NodeKeepalive(node_link));
+        resuming = true;
+        potfile_path.clear();    // the coordinator keeps potfile and history
+        history_path.clear();
+    } else if (resuming && !load_checkpoint(resume_path, resume_ck)) {
+        std::cout << "\033[1;31m[!] ERROR: Cannot read checkpoint " << resume_path << "\033[0m\n";
+        return 1;
+    }
+    if (resuming) {
+        mask_args.charsets         = resume_ck.charsets;
+        mask_args.inc_min          = resume_ck.inc_min;
+        mask_args.inc_max          = resume_ck.inc_max;
+        mask_args.markov           = resume_ck.markov;
+        mask_args.markov_threshold = resume_ck.markov_threshold;
+    }
+
     std::cout << "\n=====================================================\n";
     std::cout << "  SPEED DEMON ZIP CRACKER V6.0 (DYNAMIC BALANCING)  \n";
     std::cout << "  Supports: PKWARE, AES-128, AES-192, AES-256        \n";
     std::cout << "=====================================================\n";
     std::cout << "\033[1;33m[!] Educational use only. Use on files you own.\033[0m\n\n";
+    if (benchmark) return run_benchmark(threads_arg);
 
     // ── Get archive path ─────────────────────────────────────────────────────
-    std::cout << "[>] Enter target ZIP archive: ";
-    std::string archive_file;
-    std::getline(std::cin, archive_file);
+    std::string archive_file;      // the archive, or the archive list with --batch
+    if (resuming) {
+        archive_file = resume_ck.archive;
+        batch_path   = resume_ck.batch ? archive_file : "";
+        if (node)
+            std::cout << "[*] Joined coordinator " << connect_addr << ": " << archive_file << "\n";
+        else
+            std::cout << "[*] Resuming from " << resume_path << ": " << archive_file << "\n";
+    } else if (!batch_path.empty()) {
+        archive_file = batch_path;
+    } else {
+        std::cout << "[>] Enter target ZIP archive: ";
+        std::getline(std::cin, archive_file);
+    }
 
     if (archive_file.empty()) {
         std::cout << "\033[1;31m[!] ERROR: No file specified\033[0m\n";
         return 1;
     }
 
-    // ── Validate ZIP ─────────────────────────────────────────────────────────
-    std::cout << "\n[*] Analyzing file...\n";
-    std::string fmt = detect_format(archive_file);
-
-    if (fmt != "ZIP Archive") {
-        std::cout << "\033[1;31m[!] ERROR: Not a valid ZIP file. Detected: "
-                  << fmt << "\033[0m\n";
-        return 1;
+    // ── Batch: load every listed archive ──────────────────────────────────────
+    const bool                     batch = !batch_path.empty();
+    std::unique_ptr<CrackTarget[]> targets;
+    size_t                         target_count = 0;
+    if (batch) {
+        std::unique_ptr<std::string[]> paths;
+        size_t listed = read_batch_list(batch_path, paths);
+        if (!listed) {
+            std::cout << "\033[1;31m[!] ERROR: No archives listed in " << batch_path << "\033[0m\n";
+            return 1;
+        }
+        std::cout << "\n[*] Loading " << listed << " archives...\n";
+        targets.reset(new CrackTarget[listed]);
+        for (size_t i = 0; i < listed; ++i) {
+            CrackTarget& t = targets[target_count];
+            std::string  why;
+            if (!prepare_target(paths[i], cross_check, t, why)) {
+                std::cout << "\033[1;33m[!] Skipping " << paths[i] << ": " << why << "\033[0m\n";
+                continue;
+            }
+            std::cout << "[+] #" << target_count << " " << t.path << " — "
+                      << get_encryption_name(t.sel.enc_method) << ", entry #" << t.sel.primary
+                      << ", " << (t.native ? t.nv.engine() : std::string("libzip")) << "\n";
+            ++target_count;
+        }
+        if (!target_count) {
+            std::cout << "\033[1;31m[!] ERROR: No password-protected archives to attack\033[0m\n";
+            return 1;
+        }
+    } else {
+        targets.reset(new CrackTarget[1]);
+        target_count    = 1;
+        targets[0].path = archive_file;
     }
-    std::cout << "\033[1;32m[+] Valid ZIP archive detected\033[0m\n";
+    targets_left.store(target_count);
+
+    // Single archive: targets[0], inspected and described in full
+    TargetSelection& target   = targets[0].sel;
+    NativeVerifier&  verifier = targets[0].nv;
+    bool&            native   = targets[0].native;
+    std::string      enc_name;
+    if (!batch) {
+        // ── Validate ZIP ─────────────────────────────────────────────────────
+        std::cout << "\n[*] Analyzing file...\n";
+        std::string fmt = detect_format(archive_file);
 
-    // ── Check encryption ──────────────────────────────────────────────────────
-    bool     has_files     = false;
-    uint16_t enc_method    = ZIP_EM_NONE;
+        if (fmt != "ZIP Archive") {
+            std::cout << "\033[1;31m[!] ERROR: Not a valid ZIP file. Detected: "
+                      << fmt << "\033[0m\n";
+            return 1;
+        }
+        std::cout << "\033[1;32m[+] Valid ZIP archive detected\033[0m\n";
+
+        // ── Check encryption ──────────────────────────────────────────────────
+        bool has_files = false;
+
+        if (!is_password_protected(archive_file, has_files, target)) {
+            if (!has_files)
+                std::cout << "\033[1;31m[!] ERROR: ZIP archive is empty!\033[0m\n";
+            else
+                std::cout << "\033[1;33m[!] WARNING: ZIP is NOT password protected!\033[0m\n";
+            return 0;
+        }
+
+        uint16_t enc_method = target.enc_method;
+        enc_name = get_encryption_name(enc_method);
+        std::cout << "\033[1;32m[+] Password protection confirmed\033[0m\n";
+        std::cout << "\033[1;36m[+] Encryption: " << enc_name << "\033[0m\n";
+        if (target.encrypted > 1)
+            std::cout << "[*] Encrypted entries: " << target.encrypted << " (ZipCrypto "
+                      << target.zipcrypto << ", AES " << target.aes << ")\n";
+        std::cout << "[*] Target entry     : #" << target.primary << "\n";
+
+        if (enc_method == ZIP_EM_AES_128 ||
+            enc_method == ZIP_EM_AES_192 ||
+            enc_method == ZIP_EM_AES_256) {
+            std::cout << "\033[1;33m[!] Note: AES is slower to crack than PKWARE\033[0m\n";
+        }
 
-    if (!is_password_protected(archive_file, has_files, enc_method)) {
-        if (!has_files)
-            std::cout << "\033[1;31m[!] ERROR: ZIP archive is empty!\033[0m\n";
+        // ── Native verifier (ZipCrypto header check / AES PVV) ───────────────
+        native = load_native_verifier(archive_file, target, cross_check, verifier);
+        if (native) {
+            std::cout << "\033[1;32m[+] Native verifier enabled (" << verifier.engine()
+                      << ", " << verifier.lanes() << " lane"
+                      << (verifier.lanes() > 1 ? "s" : "") << ")\033[0m\n";
+            if (verifier.has_cross)
+                std::cout << "[*] Cross-check entry: #" << target.secondary
+                          << " (--no-cross-check if entries use different passwords)\n";
+        }
         else
-            std::cout << "\033[1;33m[!] WARNING: ZIP is NOT password protected!\033[0m\n";
-        return 0;
+            std::cout << "\033[1;33m[!] Could not parse encryption header — "
+                         "falling back to libzip\033[0m\n";
     }
 
-    std::string enc_name = get_encryption_name(enc_method);
-    std::cout << "\033[1;32m[+] Password protection confirmed\033[0m\n";
-    std::cout << "\033[1;36m[+] Encryption: " << enc_name << "\033[0m\n";
-
-    if (enc_method == ZIP_EM_AES_128 ||
-        enc_method == ZIP_EM_AES_192 ||
-        enc_method == ZIP_EM_AES_256) {
-        std::cout << "\033[1;33m[!] Note: AES is slower to crack than PKWARE\033[0m\n";
+    // ── Potfile: passwords found in earlier sessions ─────────────────────────
+    for (size_t t = 0; t < target_count; ++t) {
+        CrackTarget& tg = targets[t];
+        tg.fingerprint  = entry_fingerprint(tg.path, tg.sel.primary);
+        std::string pwd;
+        if (potfile_path.empty() || tg.fingerprint.empty() || !potfile_find(tg, pwd)) continue;
+        record_solve(tg, pwd.data(), pwd.size());
+        if (batch)
+            std::cout << "\033[1;32m[+] " << tg.path << ": " << pwd << "\033[0m (potfile)\n";
+    }
+    if (!targets_left.load()) {
+        if (batch)
+            std::cout << "\033[1;32m[+] All " << target_count << " archives are in the potfile ("
+                      << potfile_path << ")\033[0m\n";
+        else
+            std::cout << "\033[1;32m[+] PASSWORD FOUND (potfile): " << targets[0].password
+                      << "\033[0m\n";
+        return 0;
     }
 
     // ── Attack mode selection ─────────────────────────────────────────────────
-    std::cout << "\n[>] Select Attack Mode:\n";
-    std::cout << "    [1] Dictionary Attack (wordlist file)\n";
-    std::cout << "    [2] Mask Attack (?d=digit ?l=lower ?u=upper ?s=special ?a=alphanum)\n";
-    std::cout << "    [3] Single Password Test\n";
-    std::cout << "[>] Option (1-3): ";
+    int mode = resume_ck.mode;
+    if (!resuming) {
+        std::cout << "\n[>] Select Attack Mode:\n";
+        std::cout << "    [1] Dictionary Attack (wordlist file)\n";
+        std::cout << "    [2] Mask Attack (?d=digit ?l=lower ?u=upper ?s=special ?a=alphanum)\n";
+        std::cout << "    [3] Single Password Test\n";
+        std::cout << "    [4] Known-Plaintext Attack (ZipCrypto, no password needed)\n";
+        std::cout << "    [5] Hybrid Attack (wordlist + mask)\n";
+        std::cout << "    [6] Hybrid Attack (mask + wordlist)\n";
+        std::cout << "    [7] Combinator Attack (wordlist + wordlist)\n";
+        std::cout << "[>] Option (1-7): ";
 
-    int mode;
-    std::cin >> mode;
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+        std::cin >> mode;
+        std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
 
-    if (mode < 1 || mode > 3) {
+    if (mode < 1 || mode > 7) {
         std::cout << "\033[1;31m[!] Invalid option\033[0m\n";
         return 1;
     }
@@ -439,93 +5109,515 @@ int main() {
         std::string pwd;
         std::getline(std::cin, pwd);
 
+        // A correct password is recorded like any other solve (potfile)
         std::cout << "[*] Testing password...\n";
-        if (test_single_password(archive_file, pwd))
+        auto accepts = [&](CrackTarget& tg) {
+            if (!test_single_password(tg.path, tg.sel.primary, pwd)) return false;
+            if (record_solve(tg, pwd.data(), pwd.size())) potfile_add(tg);
+            return true;
+        };
+        if (batch) {
+            for (size_t t = 0; t < target_count; ++t) {
+                bool ok = accepts(targets[t]);
+                std::cout << (ok ? "\033[1;32m[+] CORRECT  " : "\033[1;31m[-] wrong    ")
+                          << targets[t].path << "\033[0m\n";
+            }
+        } else if (accepts(targets[0]))
             std::cout << "\033[1;32m[+] SUCCESS! Password is correct!\033[0m\n";
         else
             std::cout << "\033[1;31m[-] FAILED! Password is incorrect.\033[0m\n";
         return 0;
     }
 
+    // ── Mode 4: known-plaintext attack ────────────────────────────────────────
+    if (mode == 4 && batch) {
+        std::cout << "\033[1;31m[!] ERROR: Known-plaintext mode works on one archive, "
+                     "not with --batch\033[0m\n";
+        return 1;
+    }
+    if (mode == 4) {
+        ZipEntryInfo entry;
+        std::string  name;
+        std::cout << "\n[>] Encrypted entry name (Enter for target #" << target.primary << "): ";
+        std::getline(std::cin, name);
+        bool ok = name.empty() ? read_entry_info(archive_file, target.primary, entry)
+                               : find_entry(archive_file, name, entry);
+        if (!ok || !(entry.flags & 0x0001) || (entry.flags & 0x0040) || entry.aes_strength) {
+            std::cout << "\033[1;31m[!] ERROR: Entry not found or not ZipCrypto-encrypted\033[0m\n";
+            return 1;
+        }
+
+        std::string plain_path, plain;
+        std::cout << "[>] Known plaintext file (raw bytes, or an unencrypted ZIP): ";
+        std::getline(std::cin, plain_path);
+        if (detect_format(plain_path) == "ZIP Archive") {
+            // Same file stored without a password: its compressed bytes are the plaintext
+            std::string  pname;
+            ZipEntryInfo pe;
+            std::cout << "[>] Entry in that ZIP (Enter for " << entry.name << "): ";
+            std::getline(std::cin, pname);
+            if (!find_entry(plain_path, pname.empty() ? entry.name : pname, pe) ||
+                (pe.flags & 0x0001)) {
+                std::cout << "\033[1;31m[!] ERROR: No unencrypted entry by that name\033[0m\n";
+                return 1;
+            }
+            if (pe.method != entry.method)
+                std::cout << "\033[1;33m[!] Compression methods differ — plaintext may not match\033[0m\n";
+            std::ifstream pf(plain_path, std::ios::binary);
+            plain.resize(static_cast<size_t>(std::min<uint64_t>(pe.comp_size, KPA_MAX_PLAIN)));
+            if (!read_at(pf, pe.data_off, &plain[0], plain.size())) plain.clear();
+        } else {
+            std::ifstream pf(plain_path, std::ios::binary);
+            plain.resize(KPA_MAX_PLAIN);
+            pf.read(&plain[0], static_cast<std::streamsize>(plain.size()));
+            plain.resize(static_cast<size_t>(std::max<std::streamsize>(pf.gcount(), 0)));
+        }
+
+        std::string off_s;
+        long long   offset = 0;
+        std::cout << "[>] Plaintext offset in the entry data (Enter for 0, -12 = header start): ";
+        std::getline(std::cin, off_s);
+        try { if (!off_s.empty()) offset = std::stoll(off_s); } catch (...) { offset = -13; }
+
+        KpaInput in;
+        if (!kpa_load(archive_file, entry, plain, offset, in)) {
+            std::cout << "\033[1;31m[!] ERROR: Need at least " << KPA_MIN_PLAIN
+                      << " known bytes inside the entry at that offset\033[0m\n";
+            return 1;
+        }
+        std::cout << "[*] Known plaintext: " << format_number(in.plain_len)
+                  << " bytes of " << entry.name << " at offset " << offset << "\n";
+
+        // Same pool sizing and pinning as the password modes
+        topology    = detect_topology();
+        int threads = threads_arg > 0 ? std::min(threads_arg, MAX_THREADS) : topology.count;
+        std::signal(SIGINT,  on_stop_signal);
+        std::signal(SIGTERM, on_stop_signal);
+        std::cout << "[*] Recovering keys on " << threads << " threads (" << topology.count << " CPUs"
+                  << (pin_workers && topology.cpu[0] >= 0 ? ", pinned)...\n" : ")...\n");
+
+        auto     t0 = std::chrono::steady_clock::now();
+        uint32_t keys[3] = {0, 0, 0};
+        bool     found   = kpa_attack(in, threads, keys);
+        double   secs    = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (!found) {
+            std::cout << (stop_requested.load()
+                              ? "\033[1;33m[-] Stopped before all candidates were tried\033[0m\n"
+                              : "\033[1;31m[-] No keys match — check the plaintext and offset\033[0m\n");
+            return 1;
+        }
+
+        std::ostringstream hex;
+        hex << std::hex << std::setfill('0') << std::setw(8) << keys[0] << ' '
+            << std::setw(8) << keys[1] << ' ' << std::setw(8) << keys[2];
+        std::cout << "\033[1;32m[+] KEYS FOUND: " << hex.str() << "\033[0m  ("
+                  << format_time(secs) << ")\n";
+
+        std::string out_dir = archive_file + ".decrypted";
+        size_t      files   = kpa_extract(archive_file, keys, out_dir);
+        std::cout << "[*] " << files << " file(s) decrypted into " << out_dir << "\n";
+        return 0;
+    }
+
     // ── Collect mode-specific input ───────────────────────────────────────────
-    std::string wordlist_path, mask_pattern;
+    const bool  from_words = (mode != 2);         // modes 1, 5-7 read a base wordlist
+    std::string wordlist_path, mask_pattern, rules_path, part_spec;
+    MarkovStats markov;                           // masks, --markov
+    RuleSet     rule_set;                         // mode 1: expanded inside workers
+    CrossPart   part;                             // modes 5-7: joined inside workers
+    std::unique_ptr<MaskKeyspace>   mask_space;   // mode 2: generated inside workers
+    std::unique_ptr<MaskKeyspace>   part_mask;    // modes 5/6: stepped per base word
+    std::unique_ptr<MappedWordlist> part_words;   // mode 7: walked per base word
+    std::unique_ptr<MappedWordlist> word_map;     // regular-file wordlists: split across workers
+    Compression word_comp = COMP_NONE;            // compressed wordlists are streamed
 
-    if (mode == 1) {
-        std::cout << "\n[>] Enter wordlist file path: ";
-        std::getline(std::cin, wordlist_path);
+    // Mask with the command-line options, prompting for custom charsets it
+    // uses but nobody defined; `what` labels the size line. nullptr on error.
+    auto build_mask = [&](const std::string& pattern, const char* what) -> MaskKeyspace* {
+        MaskOptions mopts;
+        for (int c = 0; c < 4; ++c) {
+            std::string code = "?" + std::to_string(c + 1);
+            if (pattern.find(code) != std::string::npos && mask_args.charsets[c].empty()) {
+                std::cout << "[>] Custom charset " << code << " (e.g. ?l?d_-): ";
+                std::getline(std::cin, mask_args.charsets[c]);
+            }
+            mopts.custom[c] = expand_charset(mask_args.charsets[c]);
+        }
+        mopts.min_len   = mask_args.inc_min;
+        mopts.max_len   = mask_args.inc_max;
+        mopts.threshold = mask_args.markov_threshold;
+
+        size_t full = estimate_mask_size(pattern, mopts);
+        if (!mask_args.markov.empty()) {
+            if (!markov.train(mask_args.markov)) {
+                std::cout << "\033[1;31m[!] ERROR: Cannot train Markov stats from "
+                          << mask_args.markov << "\033[0m\n";
+                return nullptr;
+            }
+            mopts.markov = &markov;
+            std::cout << "[*] Markov order trained from " << mask_args.markov << "\n";
+        }
+
+        size_t estimated = estimate_mask_size(pattern, mopts);
+        if (estimated == std::numeric_limits<size_t>::max()) {
+            std::cout << "\033[1;31m[!] ERROR: Mask size overflow or empty custom charset\033[0m\n";
+            return nullptr;
+        }
+        std::cout << "[*] " << what << ": " << format_number(estimated);
+        if (mopts.markov && estimated != full)
+            std::cout << " (threshold keeps " << std::fixed << std::setprecision(4)
+                      << (100.0 * estimated / full) << "% of " << format_number(full) << ")";
+        std::cout << "\n";
+        MaskKeyspace* m = new MaskKeyspace(pattern, mopts);
+        if (mopts.min_len)
+            std::cout << "[*] Increment: lengths " << std::min(mopts.min_len, m->length())
+                      << " to " << m->length() << "\n";
+        return m;
+    };
+
+    if (from_words) {
+        if (resuming) {
+            wordlist_path = resume_ck.target;
+        } else {
+            std::cout << "\n[>] Enter wordlist file path: ";
+            std::getline(std::cin, wordlist_path);
+        }
         if (wordlist_path.empty()) {
             std::cout << "\033[1;31m[!] ERROR: No wordlist specified\033[0m\n";
             return 1;
         }
-        // Quick existence check
-        {
+        // Quick existence check ("-" streams from stdin)
+        if (wordlist_path != "-") {
             std::ifstream probe(wordlist_path);
             if (!probe.is_open()) {
                 std::cout << "\033[1;31m[!] ERROR: Cannot open wordlist file\033[0m\n";
                 return 1;
             }
+            word_comp = sniff_compression(wordlist_path);
         }
-    } else {   // mode == 2
-        std::cout << "\n[>] Enter mask pattern: ";
-        std::getline(std::cin, mask_pattern);
-        if (mask_pattern.empty()) {
-            std::cout << "\033[1;31m[!] ERROR: No mask specified\033[0m\n";
+        if (const char* flags = compression_missing(word_comp)) {
+            std::cout << "\033[1;31m[!] ERROR: " << compression_name(word_comp)
+                      << " support not compiled in (rebuild with " << flags << ")\033[0m\n";
             return 1;
         }
+    }
 
-        size_t estimated = estimate_mask_size(mask_pattern);
-        if (estimated == std::numeric_limits<size_t>::max()) {
-            std::cout << "\033[1;31m[!] ERROR: Mask size overflow — pattern too large\033[0m\n";
+    if (mode == 1) {
+        if (resuming) {
+            rules_path = resume_ck.rules;
+        } else {
+            std::cout << "[>] Rule file (Enter for none): ";
+            std::getline(std::cin, rules_path);
+        }
+        if (!rules_path.empty()) {
+            if (!rule_set.load(rules_path)) {
+                std::cout << "\033[1;31m[!] ERROR: No usable rules in " << rules_path << "\033[0m\n";
+                return 1;
+            }
+            std::cout << "[*] Rules loaded: " << format_number(rule_set.count());
+            if (rule_set.skipped())
+                std::cout << " (" << format_number(rule_set.skipped()) << " unsupported skipped)";
+            std::cout << " — each word yields " << format_number(rule_set.count())
+                      << " candidates\n";
+        }
+    } else if (mode == 5 || mode == 6) {
+        if (resuming) {
+            part_spec = resume_ck.part;
+        } else {
+            std::cout << (mode == 5 ? "[>] Mask appended to each word: "
+                                    : "[>] Mask prepended to each word: ");
+            std::getline(std::cin, part_spec);
+        }
+        if (part_spec.empty()) {
+            std::cout << "\033[1;31m[!] ERROR: No mask specified\033[0m\n";
+            return 1;
+        }
+        part_mask.reset(build_mask(part_spec, "Mask candidates per word"));
+        if (!part_mask) return 1;
+        part.mask   = part_mask.get();
+        part.size   = part_mask->size();
+        part.before = (mode == 6);
+    } else if (mode == 7) {
+        if (resuming) {
+            part_spec = resume_ck.part;
+        } else {
+            std::cout << "[>] Second wordlist (appended to each word): ";
+            std::getline(std::cin, part_spec);
+        }
+        // Walked once per base word, so it has to be a mapped regular file
+        if (sniff_compression(part_spec) != COMP_NONE) {
+            std::cout << "\033[1;31m[!] ERROR: Second wordlist must be uncompressed "
+                         "(decompress it or run compile-wordlist)\033[0m\n";
+            return 1;
+        }
+        part_words.reset(new MappedWordlist(part_spec));
+        if (!part_words->valid()) {
+            std::cout << "\033[1;31m[!] ERROR: Second wordlist must be a regular file"
+                      << (part_words->damaged() ? " (compiled file is damaged)" : "") << "\033[0m\n";
             return 1;
         }
-        std::cout << "[*] Estimated passwords: " << format_number(estimated) << "\n";
+        part.words = part_words.get();
+        part.size  = part_words->count_lines();
+        if (part.size == 0) {
+            std::cout << "\033[1;31m[!] ERROR: Second wordlist is empty\033[0m\n";
+            return 1;
+        }
+        std::cout << "[*] Second wordlist: " << format_number(part.size)
+                  << " words joined to each base word\n";
+    }
+
+    // Candidates per base word (rules or the joined part expand it)
+    size_t amplify = rule_set.count() ? rule_set.count() : part.size ? part.size : 1;
 
-        if (estimated > MAX_MASK_SIZE) {
-            std::cout << "\033[1;31m[!] ERROR: Mask too large (max "
-                      << format_number(MAX_MASK_SIZE) << ")\033[0m\n";
-            std::cout << "\033[1;33m[!] TIP: Reduce complexity or use shorter patterns\033[0m\n";
+    if (from_words) {
+        if (wordlist_path != "-" && word_comp == COMP_NONE)
+            word_map.reset(new MappedWordlist(wordlist_path));
+        if (word_comp != COMP_NONE)
+            std::cout << "[*] " << compression_name(word_comp)
+                      << "-compressed wordlist — decompressing ahead of the workers\n";
+        if (word_map && word_map->damaged()) {
+            std::cout << "\033[1;31m[!] ERROR: Damaged compiled wordlist\033[0m\n";
             return 1;
         }
-        if (estimated > 1'000'000) {
-            std::cout << "\033[1;33m[!] WARNING: Large mask — generation is streamed, "
-                         "no memory spike\033[0m\n";
+        if (word_map && word_map->valid()) {
+            // Lines are counted up front so progress and ETA cover the whole run
+            uint64_t lines = word_map->count_lines();
+            word_map->scale_chunk(amplify);
+            size_t   total = 0;
+            safe_multiply(lines, amplify, total);   // overflow: attempts only
+            total_passwords.store(total, std::memory_order_relaxed);
+            if (word_map->compiled())
+                std::cout << "[*] Compiled wordlist memory-mapped (" << format_number(lines)
+                          << " unique words, split across workers)\n";
+            else
+                std::cout << "[*] Wordlist memory-mapped (" << format_number(word_map->size())
+                          << " bytes, " << format_number(lines) << " words, split across workers)\n";
+            if (amplify > 1)
+                std::cout << "[*] Estimated passwords: "
+                          << (total ? format_number(total) : std::string("overflow")) << "\n";
+        } else {
+            word_map.reset();
+            std::cout << "[*] Wordlist is not a regular file — streaming\n";
+        }
+    } else {   // mode == 2
+        if (resuming) {
+            mask_pattern = resume_ck.target;
+        } else {
+            std::cout << "\n[>] Enter mask pattern: ";
+            std::getline(std::cin, mask_pattern);
+        }
+        if (mask_pattern.empty()) {
+            std::cout << "\033[1;31m[!] ERROR: No mask specified\033[0m\n";
+            return 1;
         }
+        mask_space.reset(build_mask(mask_pattern, "Estimated passwords"));
+        if (!mask_space) return 1;
+        if (mask_space->specialised())
+            std::cout << "[*] Generator: specialised kernel (" << mask_space->length() << " fixed positions)\n";
 
         // Pre-set total so workers can show percentage from the start
-        total_passwords.store(estimated, std::memory_order_relaxed);
+        total_passwords.store(mask_space->size(), std::memory_order_relaxed);
+    }
+
+    // ── Checkpointing (mapped wordlists and masks) ────────────────────────────
+    bool        resumable = mask_space || word_map;
+    std::string ckpt_path = resuming ? resume_path : archive_file + ".checkpoint";
+    Checkpoint  ckpt;
+    if (resumable) {
+        ckpt.archive     = archive_file;
+        ckpt.batch       = batch;
+        for (size_t t = 0; t < target_count; ++t)
+            ckpt.fingerprint += (t ? "," : "") +
+                                archive_fingerprint(targets[t].path, targets[t].sel.primary);
+        ckpt.mode        = mode;
+        ckpt.target      = from_words ? wordlist_path : mask_pattern;
+        ckpt.rules       = rules_path;
+        ckpt.part        = part_spec;
+        if (mask_space || part_mask) {
+            ckpt.charsets         = mask_args.charsets;
+            ckpt.inc_min          = mask_args.inc_min;
+            ckpt.inc_max          = mask_args.inc_max;
+            ckpt.markov           = mask_args.markov;
+            ckpt.markov_threshold = mask_args.markov_threshold;
+        }
+        ckpt.target_size = mask_space ? mask_space->size() : word_map->size();
+    }
+    if (resuming) {
+        if (!resumable || ckpt.fingerprint != resume_ck.fingerprint ||
+            ckpt.target_size != resume_ck.target_size) {
+            std::cout << "\033[1;31m[!] ERROR: "
+                      << (node ? "Local files differ from the coordinator's archive or wordlist/mask"
+                               : "Checkpoint does not match the archive or its wordlist/mask")
+                      << "\033[0m\n";
+            return 1;
+        }
+        if (mask_space) mask_space->start_at(resume_ck.position);
+        else            word_map->start_at(resume_ck.position);
+        attempts_resumed = resume_ck.attempts;
+
+        // Batch targets cracked before the interruption stay solved
+        std::istringstream solved(resume_ck.solved);
+        std::string        entry;
+        while (std::getline(solved, entry)) {
+            size_t colon = entry.find(':');
+            size_t t     = std::strtoull(entry.c_str(), nullptr, 10);
+            if (colon == std::string::npos || t >= target_count) continue;
+            std::string pwd = entry.substr(colon + 1);
+            record_solve(targets[t], pwd.data(), pwd.size());
+            std::cout << "\033[1;32m[+] " << targets[t].path << ": " << pwd
+                      << "\033[0m (solved earlier)\n";
+        }
+        if (!node)
+            std::cout << "[*] Skipping completed work: " << format_number(resume_ck.position)
+                      << (word_map ? word_map->unit() : " candidates") << "\n";
+    }
+    if (serving && !resumable) {
+        std::cout << "\033[1;31m[!] ERROR: Distributed mode needs a mask or a regular-file "
+                     "wordlist\033[0m\n";
+        return 1;
+    }
+    if (node) total_passwords.store(0);   // the coordinator tracks the whole run
+
+    // ── Session history: skip what earlier runs tried on every open target ──
+    std::string attack = resumable ? attack_key(ckpt) : "";
+    if (resumable && !resuming && !history_path.empty()) {
+        uint64_t start = NO_RANGE;
+        for (size_t t = 0; t < target_count; ++t)
+            if (!targets[t].solved.load())
+                start = std::min(start, history_done(history_path, targets[t].fingerprint, attack));
+        if (start >= ckpt.target_size) {
+            std::cout << "\033[1;33m[!] Earlier sessions already exhausted this attack "
+                         "(--no-history to run it again)\033[0m\n";
+            return 0;
+        }
+        if (start > 0) {
+            // Wordlists: byte share of the estimated total
+            size_t tot  = total_passwords.load();
+            size_t skip = mask_space ? start
+                                     : static_cast<size_t>(static_cast<double>(tot) * start / ckpt.target_size);
+            total_passwords.store(tot > skip ? tot - skip : 0);
+            if (mask_space) mask_space->start_at(start);
+            else            word_map->start_at(start);
+            std::cout << "[*] Earlier sessions covered " << format_number(start)
+                      << (word_map ? word_map->unit() : " candidates") << " — skipping them\n";
+        }
     }
+    std::signal(SIGINT,  on_stop_signal);
+    std::signal(SIGTERM, on_stop_signal);
 
     // ── Configure thread pool ─────────────────────────────────────────────────
-    unsigned int hw = std::thread::hardware_concurrency();
-    int CORES = (hw > 0) ? static_cast<int>(hw) : 4;
-    if (CORES > MAX_THREADS) CORES = MAX_THREADS;
+    topology  = detect_topology();
+    int CORES = serving ? 0 : threads_arg > 0 ? std::min(threads_arg, MAX_THREADS) : topology.count;
+    if (mask_space) mask_space->fit_workers(CORES);
+    if (word_map)   word_map->fit_workers(CORES);
 
-    std::cout << "[*] Using " << CORES << " CPU cores\n";
+    int listen_fd = -1;
+    if (serving) {
+        listen_fd = net_open(serve_addr, true);
+        if (listen_fd < 0) {
+            std::cout << "\033[1;31m[!] ERROR: Cannot listen on " << serve_addr << "\033[0m\n";
+            return 1;
+        }
+        std::cout << "[*] Coordinator listening on " << serve_addr
+                  << " — start nodes with --connect <host>:<port>\n";
+    } else {
+        std::cout << "[*] Using " << CORES << " worker threads on " << topology.count << " CPUs";
+        if (topology.packages > 1) std::cout << " (" << topology.packages << " sockets)";
+        std::cout << (pin_workers && topology.cpu[0] >= 0 ? ", pinned\n" : "\n");
+    }
     std::cout << "\n\033[1;36m[*] Starting attack with dynamic balancing...\033[0m\n\n";
 
     // ── Launch producer + workers ─────────────────────────────────────────────
-    BoundedQueue<std::string> pwd_queue(QUEUE_CAPACITY);
+    CandidateChannel channel(std::max<size_t>(BLOCK_POOL, 4 * static_cast<size_t>(CORES)));
+    RangePool        pool(std::max(CORES, 1));
     auto start_time = std::chrono::steady_clock::now();
 
-    // Producer thread
+    // Reporter: progress line / JSON lines / batch notices, sampled from the slots
+    // (the coordinator draws its own line from the nodes' counts)
+    std::atomic<bool> stats_done(false);
+    std::thread       reporter;
+    if (!serving)
+        reporter = std::thread(stats_reporter, CORES, targets.get(), target_count,
+                               start_time, std::cref(stats_done));
+
+    // Checkpoints: saved here for local runs, by serve_attack for a coordinator
+    const bool        keep_state = resumable && !node;
+    std::atomic<bool> ckpt_done(false);
+    std::thread       ckpt_thread;
+    if (keep_state && !serving)
+        ckpt_thread = std::thread(checkpointer, ckpt_path, ckpt, mask_space.get(),
+                                  word_map.get(), &pool, CORES, targets.get(), target_count,
+                                  std::cref(ckpt_done));
+
+    // Producer thread (streamed wordlists only — mapped wordlists and masks
+    // are generated by the workers themselves)
     std::thread producer;
-    if (mode == 1)
-        producer = std::thread(wordlist_producer, wordlist_path, std::ref(pwd_queue));
-    else
-        producer = std::thread(mask_producer, mask_pattern, std::ref(pwd_queue));
+    bool        streaming = (from_words && !word_map);
+    if (streaming)
+        producer = std::thread(wordlist_producer, wordlist_path, std::ref(channel), amplify, CORES);
 
-    // Worker thread pool (std::array — no vector)
+    // Worker thread pool (std::array — no vector); each pins itself first.
+    // Returns once the keyspace (a node: the current lease) is exhausted.
     std::array<std::thread, MAX_THREADS> workers;
-    for (int i = 0; i < CORES; ++i)
-        workers[i] = std::thread(worker, i,
-                                 std::ref(pwd_queue),
-                                 archive_file,
-                                 start_time);
+    auto run_workers = [&] {
+        for (int i = 0; i < CORES; ++i)
+            workers[i] = std::thread([&, i] {
+                pin_to_cpu(i);
+                worker(i,
+                       streaming ? &channel : nullptr,
+                       mask_space.get(),
+                       word_map.get(),
+                       &pool,
+                       rule_set.count() ? &rule_set : nullptr,
+                       part.size ? &part : nullptr,
+                       targets.get(),
+                       target_count);
+            });
+        for (int i = 0; i < CORES; ++i)
+            if (workers[i].joinable()) workers[i].join();
+    };
+
+    ServeResult served;
+    uint64_t    leases  = 0;    // node: leases completed
+    uint64_t    reached = 0;    // everything below was tried (checkpoint / history)
+    if (serving) {
+        served  = serve_attack(listen_fd, ckpt, ckpt_path,
+                               mask_space ? mask_space->next_unclaimed() : word_map->next_unclaimed(),
+                               targets.get(), target_count, start_time);
+        reached = served.watermark;
+        ::close(listen_fd);
+    } else if (node) {
+        keepalive.reset();
+        leases = node_attack(node_link, mask_space.get(), word_map.get(), CORES,
+                             targets.get(), target_count, run_workers);
+    } else {
+        run_workers();
+        if (producer.joinable()) producer.join();
+        if (resumable) reached = mask_space ? pool.watermark(*mask_space) : pool.watermark(*word_map);
+    }
+    stats_done.store(true);
+    if (reporter.joinable()) reporter.join();
 
-    // Wait for completion
-    producer.join();
-    for (int i = 0; i < CORES; ++i)
-        if (workers[i].joinable()) workers[i].join();
+    ckpt_done.store(true);
+    if (ckpt_thread.joinable()) ckpt_thread.join();
+    if (keep_state && !history_path.empty()) {
+        for (size_t t = 0; t < target_count; ++t)
+            if (!targets[t].solved.load() && reached > 0 && !targets[t].fingerprint.empty())
+                history_record(history_path, targets[t].fingerprint, attack, reached);
+    }
+    if (keep_state) {
+        if (stop_requested.load() && !password_found.load()) {
+            ckpt.position = reached;
+            ckpt.attempts = attempts_total(CORES);
+            if (batch) ckpt.solved = solved_list(targets.get(), target_count);
+            if (save_checkpoint(ckpt_path, ckpt))
+                std::cout << "\33[2K\r\033[1;33m[!] Interrupted — progress saved. Resume with: "
+                          << argv[0] << " --resume " << ckpt_path
+                          << (serving ? " --serve " + serve_addr : std::string()) << "\033[0m\n";
+        } else {
+            std::remove(ckpt_path.c_str());   // run finished; nothing to resume
+        }
+    }
 
     // ── Results ───────────────────────────────────────────────────────────────
     auto end_time = std::chrono::steady_clock::now();
@@ -534,7 +5626,20 @@ int main() {
 
     std::cout << "\33[2K\r\n=====================================================\n";
 
-    if (password_found.load()) {
+    size_t cracked = target_count - targets_left.load();
+    if (batch) {
+        std::cout << (cracked ? "\033[1;32m" : "\033[1;31m") << "[" << (cracked ? '+' : '-')
+                  << "] Cracked " << cracked << " / " << target_count << " archives\033[0m\n";
+        for (size_t t = 0; t < target_count; ++t) {
+            if (targets[t].solved.load())
+                std::cout << "\033[1;32m    " << targets[t].path << " : "
+                          << targets[t].password << "\033[0m\n";
+            else
+                std::cout << "    " << targets[t].path << " : -\n";
+        }
+        if (stop_requested.load() && targets_left.load())
+            std::cout << "\033[1;33m[-] Stopped before the wordlist/mask was exhausted\033[0m\n";
+    } else if (password_found.load()) {
         // ╔═══════════════════════╗
         // ║   cracked by Zakaria  ║
         // ╚═══════════════════════╝
@@ -544,23 +5649,66 @@ int main() {
         std::cout << "\033[1;32m██╔══██║██║   ██║       ╚═╝\033[0m\n";
         std::cout << "\033[1;32m██║  ██║██║   ██║       ██╗\033[0m\n";
         std::cout << "\033[1;32m╚═╝  ╚═╝╚═╝   ╚═╝       ╚═╝\033[0m\n\n";
-        std::cout << "\033[1;32m[+] PASSWORD FOUND: " << correct_password << "\033[0m\n";
+        std::cout << "\033[1;32m[+] PASSWORD FOUND: " << targets[0].password << "\033[0m\n";
+    } else if (stop_requested.load()) {
+        std::cout << "\033[1;33m[-] Stopped before the wordlist/mask was exhausted\033[0m\n";
+    } else if (wordlist_failed.load()) {
+        std::cout << "\033[1;31m[-] Wordlist could not be read to the end — not exhausted\033[0m\n";
     } else {
         std::cout << "\033[1;31m[-] Password not found in wordlist/mask\033[0m\n";
     }
 
-    size_t tried = attempts_made.load();
+    size_t tried = attempts_total(CORES);
     size_t tot   = total_passwords.load();
 
     std::cout << "-----------------------------------------------------\n";
-    std::cout << "[*] Encryption  : " << enc_name << "\n";
-    std::cout << "[*] Attempts    : " << format_number(tried)
-              << " / " << format_number(tot) << "\n";
+    if (batch)
+        std::cout << "[*] Archives    : " << target_count << "\n";
+    else
+        std::cout << "[*] Encryption  : " << enc_name << "\n";
+    std::cout << "[*] Attempts    : " << format_number(tried);
+    if (tot) std::cout << " / " << format_number(tot);
+    std::cout << "\n";
     std::cout << "[*] Time        : " << format_time(seconds) << "\n";
 
     if (seconds > 0.01) {
         size_t avg_rate = static_cast<size_t>(tried / seconds);
         std::cout << "[*] Avg speed   : " << format_number(avg_rate) << " pwd/s\n";
+        if (CORES > 1) {
+            uint64_t lo = std::numeric_limits<uint64_t>::max(), hi = 0;
+            for (int i = 0; i < CORES; ++i) {
+                uint64_t w = worker_stats[i].attempts.load();
+                lo = std::min(lo, w);
+                hi = std::max(hi, w);
+            }
+            std::cout << "[*] Per worker  : " << format_number(static_cast<size_t>(lo / seconds))
+                      << " – " << format_number(static_cast<size_t>(hi / seconds)) << " pwd/s\n";
+        }
+    }
+    uint64_t phase_ns = 0;
+    for (int p = 0; p < TIME_COUNT; ++p) phase_ns += phase_total(p, CORES);
+    if (phase_ns > 0) {
+        std::cout << "[*] Time split  :";
+        for (int p = 0; p < TIME_COUNT; ++p)
+            std::cout << (p ? " | " : " ") << TIME_NAMES[p] << " " << std::fixed
+                      << std::setprecision(1) << 100.0 * phase_total(p, CORES) / phase_ns << "%";
+        std::cout << "\n";
+    }
+    if (pool.steals())
+        std::cout << "[*] Rebalanced  : " << format_number(pool.steals()) << " range steals\n";
+    if (serving)
+        std::cout << "[*] Nodes       : " << served.nodes << " joined, " << format_number(served.leases)
+                  << " leases done, " << served.requeued << " reissued\n";
+    if (node)
+        std::cout << "[*] Leases      : " << format_number(leases) << " from " << connect_addr << "\n";
+    if (native && !batch && CORES > 0) {
+        std::cout << "[*] Rejected    :";
+        for (int i = 0; i < STAGE_COUNT; ++i) {
+            if (std::strcmp(verifier.stage_name(i), "-") == 0) continue;
+            std::cout << (i ? " | " : " ") << verifier.stage_name(i) << " "
+                      << format_number(stage_total(i, CORES));
+        }
+        std::cout << "\n";
     }
     std::cout << "=====================================================\n\n";
     /* ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -570,5 +5718,5 @@ int main() {
      *  |____/|__,||_,_|__,|_| |_  |_  |_|__,|  
      *                          |___|___| by Zakaria
      * ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~ */
-    return 0;
+    return wordlist_failed.load() && !password_found.load() ? 1 : 0;
 }